@@ -1,3 +1,5 @@
+#pragma once
+
 namespace eosio {
     /**
      *  Assert if the predicate fails and use the supplied message.
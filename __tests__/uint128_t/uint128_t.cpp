@@ -284,36 +284,104 @@ void uint128_t::export_bits(std::vector<uint8_t> &ret) const {
     ConvertToVector(ret, const_cast<const uint64_t&>(LOWER));
 }
 
+// number of leading zero bits of a non-zero 64 bit word
+static uint8_t nlz64(uint64_t x){
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint8_t) __builtin_clzll(x);
+#else
+    uint8_t n = 0;
+    if (x <= 0x00000000ffffffffULL) { n += 32; x <<= 32; }
+    if (x <= 0x0000ffffffffffffULL) { n += 16; x <<= 16; }
+    if (x <= 0x00ffffffffffffffULL) { n +=  8; x <<=  8; }
+    if (x <= 0x0fffffffffffffffULL) { n +=  4; x <<=  4; }
+    if (x <= 0x3fffffffffffffffULL) { n +=  2; x <<=  2; }
+    if (x <= 0x7fffffffffffffffULL) { n +=  1; }
+    return n;
+#endif
+}
+
+// divide the 128 bit value (u1:u0) by v, requires u1 < v so the quotient fits in 64 bits
+static uint64_t divlu(const uint64_t u1, const uint64_t u0, const uint64_t v, uint64_t & r){
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    uint64_t q;
+    __asm__("divq %4" : "=a"(q), "=d"(r) : "a"(u0), "d"(u1), "rm"(v));
+    return q;
+#elif defined(__SIZEOF_INT128__)
+    const unsigned __int128 u = ((unsigned __int128) u1 << 64) | u0;
+    r = (uint64_t) (u % v);
+    return (uint64_t) (u / v);
+#else
+    // Knuth algorithm D on 32 bit digits (Hacker's Delight, divlu)
+    const uint64_t b = 1ULL << 32;
+    const uint8_t s = nlz64(v);
+    const uint64_t vn = v << s;
+    const uint64_t vn1 = vn >> 32;
+    const uint64_t vn0 = vn & 0xffffffff;
+    const uint64_t un32 = s ? (u1 << s) | (u0 >> (64 - s)) : u1;
+    const uint64_t un10 = u0 << s;
+    const uint64_t un1 = un10 >> 32;
+    const uint64_t un0 = un10 & 0xffffffff;
+
+    uint64_t q1 = un32 / vn1;
+    uint64_t rhat = un32 - q1 * vn1;
+    while (q1 >= b || q1 * vn0 > b * rhat + un1){
+        q1--;
+        rhat += vn1;
+        if (rhat >= b) break;
+    }
+
+    const uint64_t un21 = un32 * b + un1 - q1 * vn;
+    uint64_t q0 = un21 / vn1;
+    rhat = un21 - q0 * vn1;
+    while (q0 >= b || q0 * vn0 > b * rhat + un0){
+        q0--;
+        rhat += vn1;
+        if (rhat >= b) break;
+    }
+
+    r = (un21 * b + un0 - q0 * vn) >> s;
+    return q1 * b + q0;
+#endif
+}
+
 std::pair <uint128_t, uint128_t> uint128_t::divmod(const uint128_t & lhs, const uint128_t & rhs) const{
     // Save some calculations /////////////////////
     if (rhs == uint128_0){
         throw std::domain_error("Error: division or modulus by 0");
     }
-    else if (rhs == uint128_1){
-        return std::pair <uint128_t, uint128_t> (lhs, uint128_0);
-    }
-    else if (lhs == rhs){
-        return std::pair <uint128_t, uint128_t> (uint128_1, uint128_0);
-    }
-    else if ((lhs == uint128_0) || (lhs < rhs)){
+    else if (lhs < rhs){
         return std::pair <uint128_t, uint128_t> (uint128_0, lhs);
     }
 
-    std::pair <uint128_t, uint128_t> qr (uint128_0, uint128_0);
-    for(uint8_t x = lhs.bits(); x > 0; x--){
-        qr.first  <<= uint128_1;
-        qr.second <<= uint128_1;
+    uint64_t r;
 
-        if ((lhs >> (x - 1U)) & 1){
-            ++qr.second;
+    // 128 / 64: at most two hardware divides
+    if (!rhs.UPPER){
+        if (lhs.UPPER < rhs.LOWER){
+            const uint64_t q = divlu(lhs.UPPER, lhs.LOWER, rhs.LOWER, r);
+            return std::pair <uint128_t, uint128_t> (uint128_t(q), uint128_t(r));
         }
+        const uint64_t q1 = lhs.UPPER / rhs.LOWER;
+        const uint64_t q0 = divlu(lhs.UPPER % rhs.LOWER, lhs.LOWER, rhs.LOWER, r);
+        return std::pair <uint128_t, uint128_t> (uint128_t(q1, q0), uint128_t(r));
+    }
 
-        if (qr.second >= rhs){
-            qr.second -= rhs;
-            ++qr.first;
-        }
+    // 128 / 128: quotient fits in 64 bits, estimate it from the normalized
+    // top word of the divisor, it is then exact or one too small
+    const uint8_t n = nlz64(rhs.UPPER);
+    const uint64_t v1 = (rhs << n).UPPER;
+    const uint128_t u = lhs >> 1;
+    uint64_t q = divlu(u.UPPER, u.LOWER, v1, r) >> (63 - n);
+    if (q){
+        q--;
     }
-    return qr;
+
+    uint128_t rem = lhs - rhs * q;
+    if (rem >= rhs){
+        q++;
+        rem -= rhs;
+    }
+    return std::pair <uint128_t, uint128_t> (uint128_t(q), rem);
 }
 
 uint128_t uint128_t::operator/(const uint128_t & rhs) const{
@@ -371,23 +439,13 @@ const uint64_t & uint128_t::lower() const{
 }
 
 uint8_t uint128_t::bits() const{
-    uint8_t out = 0;
     if (UPPER){
-        out = 64;
-        uint64_t up = UPPER;
-        while (up){
-            up >>= 1;
-            out++;
-        }
+        return 128 - nlz64(UPPER);
     }
-    else{
-        uint64_t low = LOWER;
-        while (low){
-            low >>= 1;
-            out++;
-        }
+    if (LOWER){
+        return 64 - nlz64(LOWER);
     }
-    return out;
+    return 0;
 }
 
 std::string uint128_t::str(uint8_t base, const unsigned int & len) const{
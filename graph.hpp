@@ -0,0 +1,430 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "uniswap.hpp"
+
+/**
+ * ## graph
+ *
+ * Token/pool graph finding profitable cycles, for off-chain bots and read-only actions.
+ *
+ * Simple cycles up to `max_length` pools are enumerated on demand, depth-first through the pair index, nothing is stored per
+ * cycle: memory stays linear in pools while the cycle count grows combinatorially around hub tokens. A cycle is profitable
+ * when its negative log-price weight `-sum(log(rate))` is below zero, candidates are then sized with `compile_route` and
+ * `get_arbitrage_amount_in`. `update` walks only the cycles through the changed pool.
+ */
+namespace uniswap {
+    class graph {
+    public:
+        struct pool {
+            uint64_t token0;
+            uint64_t token1;
+            uint64_t reserve0;
+            uint64_t reserve1;
+            uint16_t fee;
+            uint16_t protocol_fee;
+            double weight0;         // -log(rate) swapping token0 into token1
+            double weight1;         // -log(rate) swapping token1 into token0
+        };
+
+        // pool traversed token0 into token1, or token1 into token0 when `reverse`
+        struct leg {
+            size_t pool;
+            bool reverse;
+        };
+
+        /**
+         * ## STRUCT `opportunity`
+         *
+         * Profitable cycle found by `graph`
+         *
+         * - `{std::vector<leg>} legs` - pools in trade order (`get_path( legs )` returns the hops)
+         * - `{uint64_t} token` - token borrowed and repaid, first token of the cycle
+         * - `{uint64_t} amount_in` - optimal input amount
+         * - `{uint64_t} amount_out` - exact output amount (`amount_out > amount_in`)
+         */
+        struct opportunity {
+            std::vector<leg> legs;
+            uint64_t token;
+            uint64_t amount_in;
+            uint64_t amount_out;
+        };
+
+        /**
+         * ## `graph`
+         *
+         * - `{size_t} [max_length=3]` - (optional) longest cycle searched by `find` and `update`, in pools (2 = same pair, 3 = triangular)
+         */
+        explicit graph( const size_t max_length = 3 ) : _max_length( max_length ) {}
+
+        /**
+         * ## `add_pool`
+         *
+         * Adds a pool, returns the pool index used by `update`
+         */
+        size_t add_pool( const uint64_t token0, const uint64_t token1, const uint64_t reserve0, const uint64_t reserve1, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+        {
+            eosio::check(token0 != token1, "SX.Uniswap: IDENTICAL_ADDRESSES");
+            eosio::check(fee < 10000 && protocol_fee < 10000, "SX.Uniswap: INVALID_FEE");
+
+            const size_t index = _pools.size();
+            _pools.push_back(pool{ token0, token1, 0, 0, fee, protocol_fee, 0, 0 });
+            set_reserves(index, reserve0, reserve1);
+
+            _tokens[token0].push_back(index);
+            _tokens[token1].push_back(index);
+            _pairs[key(token0, token1)].push_back(index);
+            return index;
+        }
+
+        /**
+         * ## `update`
+         *
+         * Sets the reserves of a pool, returns profitable cycles through it
+         */
+        std::vector<opportunity> update( const size_t index, const uint64_t reserve0, const uint64_t reserve1 )
+        {
+            eosio::check(index < _pools.size(), "SX.Uniswap: INVALID_POOL");
+            set_reserves(index, reserve0, reserve1);
+            return find(index);
+        }
+
+        /**
+         * ## `find`
+         *
+         * Returns profitable cycles through a pool, up to `max_length` pools
+         */
+        std::vector<opportunity> find( const size_t index ) const
+        {
+            eosio::check(index < _pools.size(), "SX.Uniswap: INVALID_POOL");
+            std::vector<opportunity> result;
+            const auto visit = [&]( const std::vector<leg>& legs ) { evaluate(canonical(legs), result); };
+            cycles_from(index, _max_length, false, visit);
+            return result;
+        }
+
+        /**
+         * ## `scan`
+         *
+         * Returns every profitable cycle of the graph up to `max_length` pools (the graph's `max_length` by default),
+         * each cycle is enumerated once, from its lowest pool index
+         */
+        std::vector<opportunity> scan() const
+        {
+            return scan(_max_length);
+        }
+
+        std::vector<opportunity> scan( const size_t max_length ) const
+        {
+            std::vector<opportunity> result;
+            const auto visit = [&]( const std::vector<leg>& legs ) { evaluate(legs, result); };
+            for ( size_t index = 0; index < _pools.size(); index++ ) cycles_from(index, max_length, true, visit);
+            return result;
+        }
+
+        /**
+         * ## `count_cycles`
+         *
+         * Number of simple cycles up to `max_length` pools (the graph's `max_length` by default), enumerated as `scan` does
+         */
+        size_t count_cycles() const
+        {
+            return count_cycles(_max_length);
+        }
+
+        size_t count_cycles( const size_t max_length ) const
+        {
+            size_t count = 0;
+            const auto visit = [&]( const std::vector<leg>& ) { count++; };
+            for ( size_t index = 0; index < _pools.size(); index++ ) cycles_from(index, max_length, true, visit);
+            return count;
+        }
+
+        /**
+         * ## `get_path`
+         *
+         * Returns the hops of a list of legs, as used by `get_amounts_out`
+         */
+        std::vector<hop> get_path( const std::vector<leg>& legs ) const
+        {
+            std::vector<hop> path;
+            path.reserve(legs.size());
+            for ( const leg& l : legs ) {
+                eosio::check(l.pool < _pools.size(), "SX.Uniswap: INVALID_POOL");
+                path.push_back(get_hop(_pools[l.pool], l.reverse));
+            }
+            return path;
+        }
+
+        /**
+         * ## STRUCT `best_path`
+         *
+         * - `{std::vector<leg>} legs` - pools in trade order, empty if `token_out` is unreachable
+         * - `{uint64_t} amount_out` - exact output amount of chaining `get_amount_out`
+         */
+        struct best_path {
+            std::vector<leg> legs;
+            uint64_t amount_out;
+        };
+
+        /**
+         * ## `get_best_path`
+         *
+         * Finds the path of up to `max_hops` pools maximizing the output of swapping `amount_in` of `token_in` into `token_out`
+         *
+         * Branch and bound: a swap never outputs more than its spot rate times the input, so every branch is bounded by
+         * `amount * rate * bound(next)`, with `bound` the best spot-rate product from a token to `token_out` (precomputed backwards
+         * per remaining hop count, only over the tokens reachable from `token_in` within `max_hops`). Branches whose bound cannot beat the best path found so far are discarded before any
+         * `get_amount_out` division, candidates are explored by descending bound.
+         *
+         * ### params
+         *
+         * - `{uint64_t} token_in` - input token
+         * - `{uint64_t} token_out` - output token
+         * - `{uint64_t} amount_in` - amount input
+         * - `{size_t} [max_hops=3]` - (optional) longest path, in pools
+         */
+        best_path get_best_path( const uint64_t token_in, const uint64_t token_out, const uint64_t amount_in, const size_t max_hops = 3 ) const
+        {
+            eosio::check(amount_in > 0, "SX.Uniswap: INSUFFICIENT_INPUT_AMOUNT");
+            eosio::check(token_in != token_out, "SX.Uniswap: IDENTICAL_ADDRESSES");
+
+            best_path best = { {}, 0 };
+            if ( max_hops == 0 ) return best;
+
+            // distance[token]: fewest hops from token_in, tokens further than max_hops are never reached by the search
+            std::map<uint64_t, size_t> distance = { { token_in, 0 } };
+            std::vector<uint64_t> frontier = { token_in };
+            for ( size_t d = 1; d <= max_hops && !frontier.empty(); d++ ) {
+                std::vector<uint64_t> next;
+                for ( const uint64_t token : frontier ) {
+                    const auto it = _tokens.find(token);
+                    if ( it == _tokens.end() ) continue;
+                    for ( const size_t index : it->second ) {
+                        const pool& p = _pools[index];
+                        const uint64_t other = p.token0 == token ? p.token1 : p.token0;
+                        if ( distance.emplace(other, d).second ) next.push_back(other);
+                    }
+                }
+                frontier.swap(next);
+            }
+            if ( distance.find(token_out) == distance.end() ) return best;
+
+            // bounds[h][token]: best spot-rate product from token to token_out within h hops, only for tokens
+            // within `max_hops - h` hops of token_in since the search looks up no others
+            std::vector<std::map<uint64_t, double>> bounds(max_hops);
+            bounds[0][token_out] = 1;
+            for ( size_t h = 1; h < max_hops; h++ ) {
+                for ( const auto& target : bounds[h - 1] ) {
+                    if ( distance[target.first] <= max_hops - h ) {
+                        double& bound = bounds[h][target.first];
+                        bound = std::max(bound, target.second);
+                    }
+                    const auto it = _tokens.find(target.first);
+                    if ( it == _tokens.end() ) continue;
+                    for ( const size_t index : it->second ) {
+                        const pool& p = _pools[index];
+                        const bool reverse = p.token0 == target.first;
+                        const uint64_t token = reverse ? p.token1 : p.token0;
+                        const auto d = distance.find(token);
+                        if ( d == distance.end() || d->second > max_hops - h ) continue;
+                        double& bound = bounds[h][token];
+                        bound = std::max(bound, spot_rate(p, reverse) * target.second);
+                    }
+                }
+            }
+
+            std::vector<leg> legs;
+            std::vector<uint64_t> tokens = { token_in };
+            search(token_out, amount_in, bounds, legs, tokens, best);
+            return best;
+        }
+
+        const std::vector<pool>& pools() const { return _pools; }
+
+    private:
+        size_t _max_length;
+        std::vector<pool> _pools;
+        std::map<uint64_t, std::vector<size_t>> _tokens;
+        std::map<std::pair<uint64_t, uint64_t>, std::vector<size_t>> _pairs;
+
+        void set_reserves( const size_t index, const uint64_t reserve0, const uint64_t reserve1 )
+        {
+            pool& p = _pools[index];
+            p.reserve0 = reserve0;
+            p.reserve1 = reserve1;
+
+            // empty pools never close a profitable cycle
+            const double fee_multiplier = (10000.0 - p.fee) * (10000.0 - p.protocol_fee) / 100000000.0;
+            const double log_reserves = std::log(static_cast<double>(reserve1)) - std::log(static_cast<double>(reserve0));
+            p.weight0 = reserve0 && reserve1 ? -(std::log(fee_multiplier) + log_reserves) : HUGE_VAL;
+            p.weight1 = reserve0 && reserve1 ? -(std::log(fee_multiplier) - log_reserves) : HUGE_VAL;
+        }
+
+        // cycles starting with pool `first` traversed token0 into token1, `lowest` skips pools below `first` so a full scan
+        // enumerates every cycle once
+        template <class Visit>
+        void cycles_from( const size_t first, const size_t max_length, const bool lowest, Visit& visit ) const
+        {
+            if ( max_length < 2 ) return;
+            std::vector<leg> legs = { leg{ first, false } };
+            std::vector<uint64_t> tokens = { _pools[first].token0, _pools[first].token1 };
+            extend(legs, tokens, max_length, lowest, visit);
+        }
+
+        // cycle as `scan` enumerates it, from its lowest pool traversed token0 into token1, so sizing starts from the same token
+        static std::vector<leg> canonical( const std::vector<leg>& legs )
+        {
+            size_t lowest = 0;
+            for ( size_t i = 1; i < legs.size(); i++ ) if ( legs[i].pool < legs[lowest].pool ) lowest = i;
+
+            std::vector<leg> result;
+            result.reserve(legs.size());
+            for ( size_t i = 0; i < legs.size(); i++ ) {
+                if ( legs[lowest].reverse ) {
+                    const leg& l = legs[(lowest + legs.size() - i) % legs.size()];
+                    result.push_back(leg{ l.pool, !l.reverse });
+                } else {
+                    result.push_back(legs[(lowest + i) % legs.size()]);
+                }
+            }
+            return result;
+        }
+
+        // depth-first extension of `legs`, closing back to `tokens[0]` through the pair index, tokens are visited at most once
+        template <class Visit>
+        void extend( std::vector<leg>& legs, std::vector<uint64_t>& tokens, const size_t max_length, const bool lowest, Visit& visit ) const
+        {
+            const size_t first = legs[0].pool;
+            const auto pair = _pairs.find(key(tokens.back(), tokens[0]));
+            if ( pair != _pairs.end() ) {
+                for ( const size_t index : pair->second ) {
+                    if ( index == first || (lowest && index < first) ) continue;
+                    legs.push_back(leg{ index, _pools[index].token1 == tokens.back() });
+                    visit(legs);
+                    legs.pop_back();
+                }
+            }
+            if ( legs.size() + 1 >= max_length ) return;
+
+            const auto it = _tokens.find(tokens.back());
+            if ( it == _tokens.end() ) return;
+            for ( const size_t index : it->second ) {
+                if ( index == first || (lowest && index < first) ) continue;
+                const pool& p = _pools[index];
+                const bool reverse = p.token1 == tokens.back();
+                const uint64_t next = reverse ? p.token0 : p.token1;
+                if ( next == tokens[0] || visited(tokens, next) ) continue;
+
+                legs.push_back(leg{ index, reverse });
+                tokens.push_back(next);
+                extend(legs, tokens, max_length, lowest, visit);
+                tokens.pop_back();
+                legs.pop_back();
+            }
+        }
+
+        static std::pair<uint64_t, uint64_t> key( const uint64_t a, const uint64_t b )
+        {
+            return a < b ? std::make_pair(a, b) : std::make_pair(b, a);
+        }
+
+        static bool visited( const std::vector<uint64_t>& tokens, const uint64_t token )
+        {
+            for ( const uint64_t t : tokens ) if ( t == token ) return true;
+            return false;
+        }
+
+        static hop get_hop( const pool& p, const bool reverse )
+        {
+            return reverse ? hop{ p.reserve1, p.reserve0, p.fee, p.protocol_fee } : hop{ p.reserve0, p.reserve1, p.fee, p.protocol_fee };
+        }
+
+        // no-slippage output per unit of input, protocol fee left out so the bound holds with its rounding
+        static double spot_rate( const pool& p, const bool reverse )
+        {
+            if ( p.reserve0 == 0 || p.reserve1 == 0 ) return 0;
+            const double rate = reverse ? static_cast<double>(p.reserve0) / p.reserve1 : static_cast<double>(p.reserve1) / p.reserve0;
+            return rate * (10000 - p.fee) / 10000;
+        }
+
+        // depth-first branch and bound from `tokens.back()`, `bounds.size() - legs.size()` hops left
+        void search( const uint64_t token_out, const uint64_t amount, const std::vector<std::map<uint64_t, double>>& bounds, std::vector<leg>& legs, std::vector<uint64_t>& tokens, best_path& best ) const
+        {
+            const auto it = _tokens.find(tokens.back());
+            if ( it == _tokens.end() ) return;
+            const std::map<uint64_t, double>& bound = bounds[bounds.size() - legs.size() - 1];
+
+            // optimistic outputs, relative margin covers floating point rounding
+            std::vector<std::pair<double, leg>> candidates;
+            for ( const size_t index : it->second ) {
+                const pool& p = _pools[index];
+                const bool reverse = p.token1 == tokens.back();
+                const uint64_t next = reverse ? p.token0 : p.token1;
+                if ( next != token_out && visited(tokens, next) ) continue;
+
+                const auto b = bound.find(next);
+                if ( b == bound.end() ) continue;
+                const double upper = static_cast<double>(amount) * spot_rate(p, reverse) * b->second * (1 + 1e-9);
+                if ( upper > best.amount_out ) candidates.emplace_back(upper, leg{ index, reverse });
+            }
+            std::sort(candidates.begin(), candidates.end(), []( const std::pair<double, leg>& a, const std::pair<double, leg>& b ) { return a.first > b.first; });
+
+            for ( const auto& candidate : candidates ) {
+                if ( candidate.first <= best.amount_out ) break;
+
+                const pool& p = _pools[candidate.second.pool];
+                const hop h = get_hop(p, candidate.second.reverse);
+                const uint64_t amount_out = detail::get_amount_out(amount, h.reserve_in, h.reserve_out, h.fee, h.protocol_fee);
+                if ( amount_out == 0 ) continue;
+
+                const uint64_t next = candidate.second.reverse ? p.token0 : p.token1;
+                legs.push_back(candidate.second);
+                if ( next == token_out ) {
+                    if ( amount_out > best.amount_out ) best = { legs, amount_out };
+                } else if ( legs.size() < bounds.size() ) {
+                    tokens.push_back(next);
+                    search(token_out, amount_out, bounds, legs, tokens, best);
+                    tokens.pop_back();
+                }
+                legs.pop_back();
+            }
+        }
+
+        // log-price screen in both directions, then exact integer sizing
+        void evaluate( const std::vector<leg>& legs, std::vector<opportunity>& result ) const
+        {
+            double weight = 0;
+            double weight_reverse = 0;
+            for ( const leg& l : legs ) {
+                const pool& p = _pools[l.pool];
+                weight += l.reverse ? p.weight1 : p.weight0;
+                weight_reverse += l.reverse ? p.weight0 : p.weight1;
+            }
+
+            const pool& first = _pools[legs[0].pool];
+            const uint64_t token = legs[0].reverse ? first.token1 : first.token0;
+            if ( weight < 0 ) size(legs, token, result);
+            if ( weight_reverse < 0 ) {
+                std::vector<leg> reversed;
+                reversed.reserve(legs.size());
+                for ( size_t i = legs.size(); i > 0; i-- ) reversed.push_back(leg{ legs[i - 1].pool, !legs[i - 1].reverse });
+                size(reversed, token, result);
+            }
+        }
+
+        void size( const std::vector<leg>& legs, const uint64_t token, std::vector<opportunity>& result ) const
+        {
+            const std::vector<hop> path = get_path(legs);
+            const route r = compile_route(path.data(), path.size());
+            const uint64_t amount_in = get_arbitrage_amount_in(r);
+            if ( amount_in == 0 ) return;
+            result.push_back(opportunity{ legs, token, amount_in, r.get_amount_out(amount_in, true) });
+        }
+    };
+}
@@ -1,10 +1,12 @@
 #!/bin/bash
 
-git clone https://github.com/stableex/sx.safemath ./__tests__/sx.safemath
-
-# compile
-g++ -std=c++11 -o uniswap.t.out uniswap.t.cpp -I __tests__ -I ../
+# compile (default 128-bit backend & software uint128_t backend)
+g++ -std=c++17 -o uniswap.t.out uniswap.t.cpp -I __tests__
+g++ -std=c++17 -o uniswap.software.t.out uniswap.t.cpp -I __tests__ -DUNISWAP_UINT128=UNISWAP_UINT128_SOFTWARE
 
 # test
 ./uniswap.t.out --success
+./uniswap.software.t.out --success
 
+# benchmark (hidden tests)
+# ./uniswap.t.out "[benchmark]"
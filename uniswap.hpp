@@ -1,8 +1,580 @@
 #pragma once
 
-#include <sx.safemath/safemath.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <eosio/check.hpp>
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+    #include <stdexcept>
+#endif
+
+/**
+ * ## 128-bit backend
+ *
+ * Intermediate products are computed with `uniswap::uint128`, selected at compile time:
+ *
+ * - `UNISWAP_UINT128_EOSIO` - `uint128_t` provided by eosio.cdt (compiler-rt, default for contracts)
+ * - `UNISWAP_UINT128_NATIVE` - GCC/Clang `unsigned __int128` (default for hosts supporting it)
+ * - `UNISWAP_UINT128_SOFTWARE` - software `uint128_t` class (must be included before `uniswap.hpp`)
+ *
+ * Define `UNISWAP_UINT128` to one of the above to override the default.
+ */
+#define UNISWAP_UINT128_SOFTWARE 1
+#define UNISWAP_UINT128_NATIVE 2
+#define UNISWAP_UINT128_EOSIO 3
+
+#ifndef UNISWAP_UINT128
+    #if defined(__eosio_cdt__)
+        #define UNISWAP_UINT128 UNISWAP_UINT128_EOSIO
+    #elif defined(__SIZEOF_INT128__)
+        #define UNISWAP_UINT128 UNISWAP_UINT128_NATIVE
+    #else
+        #define UNISWAP_UINT128 UNISWAP_UINT128_SOFTWARE
+    #endif
+#endif
+
+/**
+ * ## constexpr
+ *
+ * Math functions are `constexpr` (C++14 or later) unless the software `uint128_t` backend is selected,
+ * `UNISWAP_HAS_CONSTEXPR` reports which one applies.
+ *
+ * Namespace-scope functions are `static inline` either way, functions a translation unit does not call raise no
+ * `-Wunused-function` warning.
+ */
+#if __cplusplus >= 201402L && UNISWAP_UINT128 != UNISWAP_UINT128_SOFTWARE
+    #define UNISWAP_HAS_CONSTEXPR 1
+    #define UNISWAP_CONSTEXPR constexpr
+#else
+    #define UNISWAP_HAS_CONSTEXPR 0
+    #define UNISWAP_CONSTEXPR
+#endif
 
 namespace uniswap {
+#if UNISWAP_UINT128 == UNISWAP_UINT128_NATIVE
+    __extension__ typedef unsigned __int128 uint128;
+#else
+    typedef ::uint128_t uint128;
+#endif
+
+    namespace detail {
+        // `eosio::check` usable in constant expressions, only evaluated on failure
+        static inline UNISWAP_CONSTEXPR void check( const bool pred, const char* msg )
+        {
+            if ( !pred ) eosio::check(false, msg);
+        }
+
+        static inline UNISWAP_CONSTEXPR uint64_t hi( const uint128 x ) { return static_cast<uint64_t>(x >> 64); }
+        static inline UNISWAP_CONSTEXPR uint64_t lo( const uint128 x ) { return static_cast<uint64_t>(x); }
+        static inline UNISWAP_CONSTEXPR uint128 make_uint128( const uint64_t high, const uint64_t low ) { return (static_cast<uint128>(high) << 64) | low; }
+
+        // number of significant bits
+        static inline UNISWAP_CONSTEXPR int bits( const uint64_t x )
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return x ? 64 - __builtin_clzll(x) : 0;
+#else
+            int n = 0;
+            for ( uint64_t v = x; v; v >>= 1 ) n++;
+            return n;
+#endif
+        }
+
+        static inline UNISWAP_CONSTEXPR int bits( const uint128 x )
+        {
+            const uint64_t high = hi(x);
+            return high ? 64 + bits(high) : bits(lo(x));
+        }
+
+        // `(n2:n1:n0) / (d1:d0)` for a normalized divisor (top bit set) and `(n2:n1) < (d1:d0)`, single quotient word (Knuth algorithm D)
+        static inline UNISWAP_CONSTEXPR uint64_t div_3by2( const uint64_t n2, const uint64_t n1, const uint64_t n0, const uint64_t d1, const uint64_t d0 )
+        {
+            // estimate quotient from top words, then correct using d0
+            const uint128 top = make_uint128(n2, n1);
+            uint64_t q = n2 >= d1 ? ~uint64_t(0) : static_cast<uint64_t>( top / d1 );
+            uint128 rem = top - static_cast<uint128>(q) * d1;
+            while ( hi(rem) == 0 && static_cast<uint128>(q) * d0 > make_uint128(lo(rem), n0) ) {
+                q--;
+                rem += d1;
+            }
+
+            // estimate is now exact or one too large
+            const uint128 qd0 = static_cast<uint128>(q) * d0;
+            const uint128 qd1 = static_cast<uint128>(q) * d1;
+            const uint128 qmid = static_cast<uint128>(hi(qd0)) + lo(qd1);
+            const uint64_t c2 = hi(qd1) + hi(qmid);
+            const uint64_t c1 = lo(qmid);
+            const uint64_t c0 = lo(qd0);
+            if ( c2 > n2 || (c2 == n2 && (c1 > n1 || (c1 == n1 && c0 > n0))) ) q--;
+
+            return q;
+        }
+
+        // `mul_div` slow path for products exceeding 128 bits
+        static inline UNISWAP_CONSTEXPR uint64_t mul_div_wide( const uint128 a, const uint64_t b, const uint128 d )
+        {
+            // 192-bit product (p2:p1:p0)
+            const uint128 low = static_cast<uint128>(lo(a)) * b;
+            const uint128 high = static_cast<uint128>(hi(a)) * b;
+            const uint128 mid = static_cast<uint128>(hi(low)) + lo(high);
+            const uint64_t p0 = lo(low);
+            const uint64_t p1 = lo(mid);
+            const uint64_t p2 = hi(high) + hi(mid);
+
+            // 64-bit divisor implies p2 == 0
+            if ( hi(d) == 0 ) return static_cast<uint64_t>( make_uint128(p1, p0) / d );
+
+            // normalize divisor (d1:d0) so its top bit is set
+            const int shift = 64 - bits(hi(d));
+            const uint128 dn = d << shift;
+            const uint64_t n2 = shift ? (p2 << shift) | (p1 >> (64 - shift)) : p2;
+            const uint64_t n1 = shift ? (p1 << shift) | (p0 >> (64 - shift)) : p1;
+            const uint64_t n0 = p0 << shift;
+
+            return div_3by2(n2, n1, n0, hi(dn), lo(dn));
+        }
+
+        /**
+         * ## STATIC `mul_div`
+         *
+         * Returns `floor(a * b / d)` using a 192-bit intermediate product when `a * b` exceeds 128 bits
+         *
+         * Result must fit in 64 bits (`a * b < d * 2^64`), which holds whenever `a < d`
+         */
+        static inline UNISWAP_CONSTEXPR uint64_t mul_div( const uint128 a, const uint64_t b, const uint128 d )
+        {
+            // fast path: product fits in 128 bits
+            if ( bits(a) + bits(b) <= 128 ) return static_cast<uint64_t>( a * b / d );
+            return mul_div_wide(a, b, d);
+        }
+
+        // `floor(a * b / 2^64)`
+        static inline UNISWAP_CONSTEXPR uint128 mul_hi( const uint128 a, const uint64_t b )
+        {
+            return static_cast<uint128>(hi(a)) * b + hi(static_cast<uint128>(lo(a)) * b);
+        }
+
+        // `mul_div` without its precondition, returns false when the result exceeds 64 bits
+        static inline UNISWAP_CONSTEXPR bool try_mul_div( const uint128 a, const uint64_t b, const uint128 d, uint64_t& result )
+        {
+            if ( bits(a) + bits(b) <= 128 ) {
+                const uint128 q = a * b / d;
+                result = lo(q);
+                return hi(q) == 0;
+            }
+            // a * b < d * 2^64
+            if ( mul_hi(a, b) >= d ) return false;
+            result = mul_div_wide(a, b, d);
+            return true;
+        }
+
+        // 256-bit value (high:low) for intermediates exceeding 128 bits
+        struct uint256 {
+            uint128 high;
+            uint128 low;
+        };
+
+        // 128 x 128 -> 256-bit product
+        static inline UNISWAP_CONSTEXPR uint256 mul_wide( const uint128 a, const uint128 b )
+        {
+            const uint128 ll = static_cast<uint128>(lo(a)) * lo(b);
+            const uint128 lh = static_cast<uint128>(lo(a)) * hi(b);
+            const uint128 hl = static_cast<uint128>(hi(a)) * lo(b);
+            const uint128 hh = static_cast<uint128>(hi(a)) * hi(b);
+            const uint128 mid = static_cast<uint128>(hi(ll)) + lo(lh) + lo(hl);
+            const uint256 product = { hh + hi(lh) + hi(hl) + hi(mid), make_uint128(lo(mid), lo(ll)) };
+            return product;
+        }
+
+        static inline UNISWAP_CONSTEXPR bool less( const uint256& a, const uint256& b )
+        {
+            return a.high < b.high || (a.high == b.high && a.low < b.low);
+        }
+
+        static inline UNISWAP_CONSTEXPR uint256 add( const uint256& a, const uint256& b )
+        {
+            const uint256 sum = { a.high + b.high + (a.low + b.low < a.low ? 1 : 0), a.low + b.low };
+            return sum;
+        }
+
+        // requires b <= a
+        static inline UNISWAP_CONSTEXPR uint256 sub( const uint256& a, const uint256& b )
+        {
+            const uint256 difference = { a.high - b.high - (a.low < b.low ? 1 : 0), a.low - b.low };
+            return difference;
+        }
+
+        // requires 0 <= n < 128
+        static inline UNISWAP_CONSTEXPR uint256 shl( const uint256& a, const int n )
+        {
+            if ( n == 0 ) return a;
+            const uint256 shifted = { (a.high << n) | (a.low >> (128 - n)), a.low << n };
+            return shifted;
+        }
+
+        // requires 0 <= n < 128
+        static inline UNISWAP_CONSTEXPR uint256 shr( const uint256& a, const int n )
+        {
+            if ( n == 0 ) return a;
+            const uint256 shifted = { a.high >> n, (a.low >> n) | (a.high << (128 - n)) };
+            return shifted;
+        }
+
+        static inline UNISWAP_CONSTEXPR int bits( const uint256& x )
+        {
+            return x.high != 0 ? 128 + bits(x.high) : bits(x.low);
+        }
+
+        // `floor(x / d)` for `x.high < d`, two `div_3by2` steps on the normalized operands
+        static inline UNISWAP_CONSTEXPR uint128 div_wide( const uint256& x, const uint128 d )
+        {
+            if ( x.high == 0 ) return x.low / d;
+
+            const int shift = 128 - bits(d);
+            const uint128 dn = d << shift;
+            const uint256 n = shl(x, shift);
+            const uint64_t q1 = div_3by2(hi(n.high), lo(n.high), hi(n.low), hi(dn), lo(dn));
+            const uint128 r = make_uint128(lo(n.high), hi(n.low)) - static_cast<uint128>(q1) * dn;
+            const uint64_t q0 = div_3by2(hi(r), lo(r), lo(n.low), hi(dn), lo(dn));
+            return make_uint128(q1, q0);
+        }
+
+        static inline UNISWAP_CONSTEXPR bool equal( const uint256& a, const uint256& b )
+        {
+            return a.high == b.high && a.low == b.low;
+        }
+
+        // 64-bit limb `i` (least significant first)
+        static inline UNISWAP_CONSTEXPR uint64_t limb( const uint256& x, const int i )
+        {
+            return i == 0 ? lo(x.low) : i == 1 ? hi(x.low) : i == 2 ? lo(x.high) : hi(x.high);
+        }
+
+        static inline UNISWAP_CONSTEXPR uint256 from_limbs( const uint64_t x0, const uint64_t x1, const uint64_t x2, const uint64_t x3 )
+        {
+            const uint256 x = { make_uint128(x3, x2), make_uint128(x1, x0) };
+            return x;
+        }
+
+        // 256 x 256 -> 256-bit product (mod 2^256), schoolbook on 64-bit limbs keeping the lower half
+        static inline UNISWAP_CONSTEXPR uint256 mul( const uint256& a, const uint256& b )
+        {
+            uint256 product = mul_wide(a.low, b.low);
+            product.high += a.low * b.high + a.high * b.low;
+            return product;
+        }
+
+        // `floor(u / v)` with remainder `r`, 256/128-bit divisors take two `div_wide` steps, wider ones Knuth algorithm D on 64-bit limbs
+        static inline UNISWAP_CONSTEXPR uint256 div_mod( const uint256& u, const uint256& v, uint256& r )
+        {
+            if ( v.high == 0 ) {
+                const uint128 d = v.low;
+                const uint128 q1 = u.high / d;
+                const uint256 rest = { u.high - q1 * d, u.low };
+                const uint128 q0 = div_wide(rest, d);
+                const uint256 remainder = { 0, u.low - q0 * d };
+                const uint256 quotient = { q1, q0 };
+                r = remainder;
+                return quotient;
+            }
+            if ( less(u, v) ) {
+                const uint256 zero = { 0, 0 };
+                r = u;
+                return zero;
+            }
+
+            // normalize `v` (n = 3 or 4 limbs) so its top limb has the top bit set, `u` spills into a fifth limb
+            const int n = hi(v.high) ? 4 : 3;
+            const int shift = 64 - bits(limb(v, n - 1));
+            uint64_t vn[4] = { 0, 0, 0, 0 };
+            uint64_t un[5] = { 0, 0, 0, 0, 0 };
+            for ( int i = n - 1; i > 0; i-- ) vn[i] = shift ? (limb(v, i) << shift) | (limb(v, i - 1) >> (64 - shift)) : limb(v, i);
+            vn[0] = limb(v, 0) << shift;
+            un[4] = shift ? limb(u, 3) >> (64 - shift) : 0;
+            for ( int i = 3; i > 0; i-- ) un[i] = shift ? (limb(u, i) << shift) | (limb(u, i - 1) >> (64 - shift)) : limb(u, i);
+            un[0] = limb(u, 0) << shift;
+
+            uint64_t q[2] = { 0, 0 };
+            for ( int j = 4 - n; j >= 0; j-- ) {
+                // estimate from the top three limbs, exact or one too large
+                uint64_t qhat = ~uint64_t(0);
+                if ( make_uint128(un[j + n], un[j + n - 1]) < make_uint128(vn[n - 1], vn[n - 2]) ) {
+                    qhat = div_3by2(un[j + n], un[j + n - 1], un[j + n - 2], vn[n - 1], vn[n - 2]);
+                }
+
+                // multiply and subtract
+                uint64_t borrow = 0;
+                uint64_t carry = 0;
+                for ( int i = 0; i < n; i++ ) {
+                    const uint128 p = static_cast<uint128>(qhat) * vn[i] + carry;
+                    carry = hi(p);
+                    const uint128 t = static_cast<uint128>(un[i + j]) - lo(p) - borrow;
+                    un[i + j] = lo(t);
+                    borrow = hi(t) ? 1 : 0;
+                }
+                const uint128 t = static_cast<uint128>(un[j + n]) - carry - borrow;
+                un[j + n] = lo(t);
+
+                // add back
+                if ( hi(t) ) {
+                    qhat--;
+                    uint64_t c = 0;
+                    for ( int i = 0; i < n; i++ ) {
+                        const uint128 sum = static_cast<uint128>(un[i + j]) + vn[i] + c;
+                        un[i + j] = lo(sum);
+                        c = hi(sum);
+                    }
+                    un[j + n] += c;
+                }
+                q[j] = qhat;
+            }
+
+            // denormalize remainder
+            uint64_t rn[4] = { 0, 0, 0, 0 };
+            for ( int i = 0; i < n; i++ ) rn[i] = shift ? (un[i] >> shift) | (un[i + 1] << (64 - shift)) : un[i];
+            r = from_limbs(rn[0], rn[1], rn[2], rn[3]);
+            return from_limbs(q[0], q[1], 0, 0);
+        }
+
+        static inline UNISWAP_CONSTEXPR uint256 div( const uint256& u, const uint256& v )
+        {
+            uint256 r = { 0, 0 };
+            return div_mod(u, v, r);
+        }
+
+
+        // `sqrt(x)` to double precision from a power of two within a factor sqrt(2), plain arithmetic keeps it constexpr
+        static inline UNISWAP_CONSTEXPR double sqrt_seed( const double x, const int bits )
+        {
+            double y = 1;
+            for ( int n = bits / 2; n > 0; n -= 32 ) y *= n >= 32 ? 4294967296.0 : static_cast<double>(uint64_t(1) << n);
+            for ( int i = 0; i < 6; i++ ) y = (y + x / y) / 2;
+            return y * (1 + 1.0 / (uint64_t(1) << 40)) + 1;
+        }
+
+        // `floor(sqrt(x))`: floating-point seed rounded above the root, then integer Newton steps down to it
+        static inline UNISWAP_CONSTEXPR uint64_t isqrt( const uint128 x )
+        {
+            if ( x == 0 ) return 0;
+            const double seed = sqrt_seed(static_cast<double>(hi(x)) * 18446744073709551616.0 + static_cast<double>(lo(x)), bits(x));
+            uint64_t y = seed >= 18446744073709551615.0 ? ~uint64_t(0) : static_cast<uint64_t>(seed);
+            while ( true ) {
+                const uint128 q = x / y;
+                if ( q >= y ) return y;
+                y = (y >> 1) + (lo(q) >> 1) + (y & lo(q) & 1);
+            }
+        }
+
+        // `floor(sqrt(x))`, as above with 256/128-bit Newton divisions
+        static inline UNISWAP_CONSTEXPR uint128 isqrt( const uint256& x )
+        {
+            if ( x.high == 0 ) return isqrt(x.low);
+            const double seed = sqrt_seed((static_cast<double>(hi(x.high)) * 18446744073709551616.0 + static_cast<double>(lo(x.high))) * 340282366920938463463374607431768211456.0 + static_cast<double>(hi(x.low)) * 18446744073709551616.0, bits(x));
+            uint128 y = ~uint128(0);
+            if ( seed < 340282366920938463463374607431768211455.0 ) {
+                const uint64_t high = static_cast<uint64_t>(seed / 18446744073709551616.0);
+                y = make_uint128(high, static_cast<uint64_t>(seed - static_cast<double>(high) * 18446744073709551616.0));
+            }
+            while ( true ) {
+                // x.high >= y implies a quotient above 2^128, only for x within 2^129 of 2^256
+                if ( x.high >= y ) return y;
+                const uint128 q = div_wide(x, y);
+                if ( q >= y ) return y;
+                y = (y >> 1) + (q >> 1) + (y & q & 1);
+            }
+        }
+
+        // round down protocol fees
+        // minimum 1
+        static inline UNISWAP_CONSTEXPR uint64_t protocol_fee_amount( const uint64_t amount_in, const uint16_t protocol_fee )
+        {
+            // `amount_in * protocol_fee` fits in 64 bits below 2^48
+            const uint64_t amount = (amount_in >> 48) == 0 ? amount_in * protocol_fee / 10000 : static_cast<uint64_t>(static_cast<uint128>(amount_in) * protocol_fee / 10000);
+            return (protocol_fee && amount == 0) ? 1 : amount;
+        }
+
+        // `get_amount_out` after protocol fees, `fee_multiplier` is `10000 - fee`
+        static inline UNISWAP_CONSTEXPR uint64_t get_amount_out_with_fee( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee_multiplier )
+        {
+            // 64-bit fast path: numerator below 2^64, both denominator terms below 2^63 (`reserve_out | 1` keeps `amount_in_with_fee` there)
+            if ( bits(amount_in) + bits(reserve_out | 1) + bits(static_cast<uint64_t>(fee_multiplier)) <= 64 && (reserve_in >> 49) == 0 ) {
+                const uint64_t amount_in_with_fee = amount_in * fee_multiplier;
+                return amount_in_with_fee * reserve_out / (reserve_in * 10000 + amount_in_with_fee);
+            }
+
+            const uint128 amount_in_with_fee = static_cast<uint128>(amount_in) * fee_multiplier;
+            const uint128 denominator = (static_cast<uint128>(reserve_in) * 10000) + amount_in_with_fee;
+
+            // numerator `amount_in_with_fee * reserve_out` can reach ~2^141, amount_in_with_fee < denominator keeps result within 64 bits
+            return mul_div(amount_in_with_fee, reserve_out, denominator);
+        }
+
+        // unchecked `get_amount_out`, requires `fee < 10000`, an input consumed by the protocol fee outputs nothing
+        static inline UNISWAP_CONSTEXPR uint64_t get_amount_out( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee, const uint16_t protocol_fee )
+        {
+            const uint64_t amount = protocol_fee_amount(amount_in, protocol_fee);
+            if ( amount_in <= amount ) return 0;
+            return get_amount_out_with_fee(amount_in - amount, reserve_in, reserve_out, 10000 - fee);
+        }
+
+        // minimal input whose amount after protocol fees covers `amount`, returns false when it exceeds 64 bits
+        static inline UNISWAP_CONSTEXPR bool add_protocol_fee( const uint64_t amount, const uint16_t protocol_fee, uint64_t& amount_in )
+        {
+            if ( !protocol_fee ) {
+                amount_in = amount;
+                return true;
+            }
+
+            // a - floor(a * p / 10000) = ceil(a * (10000 - p) / 10000) >= amount
+            const uint128 estimate = static_cast<uint128>(amount - 1) * 10000 / (10000 - protocol_fee) + 1;
+            if ( hi(estimate) ) return false;
+
+            // "minimum 1" protocol fee can require one more unit
+            uint64_t result = lo(estimate);
+            while ( result - protocol_fee_amount(result, protocol_fee) < amount ) {
+                if ( result == ~uint64_t(0) ) return false;
+                result++;
+            }
+            amount_in = result;
+            return true;
+        }
+
+        // unchecked `get_amount_in`, requires `amount_out < reserve_out`, `fee < 10000` and `protocol_fee < 10000`, returns false when the input exceeds 64 bits
+        static inline UNISWAP_CONSTEXPR bool get_amount_in( const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee, const uint16_t protocol_fee, uint64_t& amount_in )
+        {
+            // numerator `reserve_in * amount_out * 10000` can reach ~2^142
+            const uint128 denominator = static_cast<uint128>(reserve_out - amount_out) * (10000 - fee);
+            uint64_t quotient = 0;
+            if ( !try_mul_div(static_cast<uint128>(reserve_in) * 10000, amount_out, denominator, quotient) || quotient == ~uint64_t(0) ) return false;
+            return add_protocol_fee(quotient + 1, protocol_fee, amount_in);
+        }
+    }
+
+    /**
+     * ## ENUM `status`
+     *
+     * Reason a `try_` variant yields no amount, each matches the `eosio::check` message of the checked function
+     *
+     * - `ok`
+     * - `insufficient_input_amount` - "SX.Uniswap: INSUFFICIENT_INPUT_AMOUNT"
+     * - `insufficient_output_amount` - "SX.Uniswap: INSUFFICIENT_OUTPUT_AMOUNT"
+     * - `insufficient_amount` - "SX.Uniswap: INSUFFICIENT_AMOUNT"
+     * - `insufficient_liquidity` - "SX.Uniswap: INSUFFICIENT_LIQUIDITY"
+     * - `invalid_protocol_fee` - "SX.Uniswap: INVALID_PROTOCOL_FEE"
+     * - `overflow` - "SX.Uniswap: OVERFLOW"
+     * - `invalid_path` - "SX.Uniswap: INVALID_PATH"
+     * - `invalid_fee` - "SX.Uniswap: INVALID_FEE"
+     */
+    enum class status : uint8_t {
+        ok = 0,
+        insufficient_input_amount,
+        insufficient_output_amount,
+        insufficient_amount,
+        insufficient_liquidity,
+        invalid_protocol_fee,
+        overflow,
+        invalid_path,
+        invalid_fee
+    };
+
+    /**
+     * ## STRUCT `result`
+     *
+     * - `{uint64_t} amount` - amount, 0 unless `code` is `status::ok`
+     * - `{status} code` - status
+     */
+    struct result {
+        uint64_t amount;
+        status code;
+
+        UNISWAP_CONSTEXPR bool ok() const { return code == status::ok; }
+    };
+
+    namespace detail {
+        static inline UNISWAP_CONSTEXPR const char* message( const status code )
+        {
+            switch ( code ) {
+                case status::ok: return "SX.Uniswap: OK";
+                case status::insufficient_input_amount: return "SX.Uniswap: INSUFFICIENT_INPUT_AMOUNT";
+                case status::insufficient_output_amount: return "SX.Uniswap: INSUFFICIENT_OUTPUT_AMOUNT";
+                case status::insufficient_amount: return "SX.Uniswap: INSUFFICIENT_AMOUNT";
+                case status::insufficient_liquidity: return "SX.Uniswap: INSUFFICIENT_LIQUIDITY";
+                case status::invalid_protocol_fee: return "SX.Uniswap: INVALID_PROTOCOL_FEE";
+                case status::overflow: return "SX.Uniswap: OVERFLOW";
+                case status::invalid_path: return "SX.Uniswap: INVALID_PATH";
+                case status::invalid_fee: return "SX.Uniswap: INVALID_FEE";
+            }
+            return "SX.Uniswap: UNKNOWN";
+        }
+    }
+
+    /**
+     * ## Error policies
+     *
+     * `get_amount_out`, `get_amount_in`, `quote`, `get_amounts_out`, `get_amounts_in`, `prepared_pool::get_amount_out` and
+     * `route::get_amount_out` take a policy template parameter deciding how invalid inputs are reported:
+     *
+     * - `check_policy` - `eosio::check` aborts the transaction (default, contract semantics)
+     * - `throw_policy` - throws `uniswap::exception` (only when exceptions are enabled)
+     * - `status_policy` - returns a `result` instead of an amount
+     * - `unchecked_policy` - no validation, inputs must already satisfy the checked preconditions
+     *
+     * A policy provides `checked`, the returned `type`, `value(amount)` and `error(code)`.
+     *
+     * `get_amount_out_batch` already reports invalid lanes in its error mask, and `math<T>` amounts do not fit the `uint64_t`
+     * amount of a policy `type`, both keep `eosio::check` semantics. So do the `prepared_pool` constructor and `compile_route`
+     * (no amount to return), the solvers (`get_amount_in_to_price`, `get_arbitrage_amount_in`, `split_amount_in`) and the
+     * liquidity helpers (`get_initial_liquidity`, `get_liquidity`, `get_burn_amounts`, `get_add_liquidity_amounts`, `get_zap`).
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t amount_out = uniswap::get_amount_out<uniswap::unchecked_policy>( 10000, 45851931234, 125682033533 );
+     * // => 27328
+     * ```
+     */
+    struct check_policy {
+        typedef uint64_t type;
+        static const bool checked = true;
+        static UNISWAP_CONSTEXPR type value( const uint64_t amount ) { return amount; }
+        static type error( const status code )
+        {
+            eosio::check(false, detail::message(code));
+            return 0;
+        }
+    };
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+    struct exception : std::runtime_error {
+        status code;
+
+        explicit exception( const status code ) : std::runtime_error(detail::message(code)), code(code) {}
+    };
+
+    struct throw_policy {
+        typedef uint64_t type;
+        static const bool checked = true;
+        static UNISWAP_CONSTEXPR type value( const uint64_t amount ) { return amount; }
+        static type error( const status code ) { throw exception(code); }
+    };
+#endif
+
+    struct status_policy {
+        typedef result type;
+        static const bool checked = true;
+        static UNISWAP_CONSTEXPR type value( const uint64_t amount ) { return result{ amount, status::ok }; }
+        static UNISWAP_CONSTEXPR type error( const status code ) { return result{ 0, code }; }
+    };
+
+    struct unchecked_policy {
+        typedef uint64_t type;
+        static const bool checked = false;
+        static UNISWAP_CONSTEXPR type value( const uint64_t amount ) { return amount; }
+        static UNISWAP_CONSTEXPR type error( const status ) { return 0; }
+    };
+
     /**
      * ## STATIC `get_amount_out`
      *
@@ -31,25 +603,61 @@ namespace uniswap {
      * // => 27328
      * ```
      */
-    static uint64_t get_amount_out( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+    template <class Policy = check_policy>
+    static inline UNISWAP_CONSTEXPR typename Policy::type get_amount_out( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
     {
-        // checks
-        eosio::check(amount_in > 0, "SX.Uniswap: INSUFFICIENT_INPUT_AMOUNT");
-        eosio::check(reserve_in > 0 && reserve_out > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
-
-        // round down protocol fees
-        // minimum 1
-        uint64_t protocol_fee_amount = amount_in * protocol_fee / 10000;
-        if (protocol_fee && protocol_fee_amount == 0) {
-            protocol_fee_amount = 1;
+        // checks, folded into a single branch for valid inputs
+        if ( Policy::checked && ((amount_in == 0) | (reserve_in == 0) | (reserve_out == 0) | (fee >= 10000)) ) {
+            return Policy::error(amount_in == 0 ? status::insufficient_input_amount : reserve_in == 0 || reserve_out == 0 ? status::insufficient_liquidity : status::invalid_fee);
         }
 
-        const uint128_t amount_in_with_fee = static_cast<uint128_t>(amount_in - protocol_fee_amount) * (10000 - fee);
-        const uint128_t numerator = amount_in_with_fee * reserve_out;
-        const uint128_t denominator = (static_cast<uint128_t>(reserve_in) * 10000) + amount_in_with_fee;
-        const uint64_t amount_out = numerator / denominator;
+        const uint64_t amount_out = detail::get_amount_out(amount_in, reserve_in, reserve_out, fee, protocol_fee);
+        return Policy::value(amount_out);
+    }
+
+    /**
+     * ## STATIC `get_amount_out<fee, protocol_fee>`
+     *
+     * `get_amount_out` for a fixed fee schedule, the protocol fee branch is removed when `protocol_fee` is 0
+     * and fee constants fold into immediate multiplies
+     *
+     * ### template params
+     *
+     * - `{uint16_t} fee` - trade fee (pips 1/100 of 1%)
+     * - `{uint16_t} [protocol_fee=0]` - (optional) trade fee (pips 1/100 of 1%) fee deducted from input amount prior to trade
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_out` - reserve output
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t amount_in = 10000;
+     * const uint64_t reserve_in = 45851931234;
+     * const uint64_t reserve_out = 125682033533;
+     *
+     * // Calculation
+     * const uint64_t amount_out = uniswap::get_amount_out<30>( amount_in, reserve_in, reserve_out );
+     * // => 27328
+     * ```
+     */
+    template <uint16_t fee, uint16_t protocol_fee = 0, class Policy = check_policy>
+    static inline UNISWAP_CONSTEXPR typename Policy::type get_amount_out( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out )
+    {
+        static_assert(fee < 10000 && protocol_fee <= 10000, "SX.Uniswap: INVALID_FEE");
+
+        // checks
+        if ( Policy::checked && ((amount_in == 0) | (reserve_in == 0) | (reserve_out == 0)) ) {
+            return Policy::error(amount_in == 0 ? status::insufficient_input_amount : status::insufficient_liquidity);
+        }
 
-        return amount_out;
+        const uint64_t amount_in_after_protocol_fee = protocol_fee ? amount_in - detail::protocol_fee_amount(amount_in, protocol_fee) : amount_in;
+        const uint64_t amount_out = detail::get_amount_out_with_fee(amount_in_after_protocol_fee, reserve_in, reserve_out, 10000 - fee);
+        return Policy::value(amount_out);
     }
 
     /**
@@ -63,6 +671,8 @@ namespace uniswap {
      * - `{uint64_t} reserve_in` - reserve input
      * - `{uint64_t} reserveOut` - reserve output
      * - `{uint16_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     * - `{uint16_t} [protocol_fee=0]` - (optional) trade fee (pips 1/100 of 1%) fee deducted from input amount prior to trade,
+     *   returns the smallest input whose amount after protocol fees (minimum 1) covers the trade
      *
      * ### example
      *
@@ -78,17 +688,18 @@ namespace uniswap {
      * // => 10000
      * ```
      */
-    static uint64_t get_amount_in( const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee = 30 )
+    template <class Policy = check_policy>
+    static inline UNISWAP_CONSTEXPR typename Policy::type get_amount_in( const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
     {
-        // checks
-        eosio::check(amount_out > 0, "SX.Uniswap: INSUFFICIENT_OUTPUT_AMOUNT");
-        eosio::check(reserve_in > 0 && reserve_out > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
-
-        const uint128_t numerator = static_cast<uint128_t>(reserve_in) * amount_out * 10000;
-        const uint128_t denominator = static_cast<uint128_t>(reserve_out - amount_out) * (10000 - fee);
-        const uint64_t amount_in = (numerator / denominator) + 1;
+        // checks, `amount_out < reserve_out` also rejects an empty output reserve
+        if ( Policy::checked && ((amount_out == 0) | (reserve_in == 0) | (amount_out >= reserve_out) | (fee >= 10000) | (protocol_fee >= 10000)) ) {
+            return Policy::error(amount_out == 0 ? status::insufficient_output_amount : reserve_in == 0 || amount_out >= reserve_out ? status::insufficient_liquidity : fee >= 10000 ? status::invalid_fee : status::invalid_protocol_fee);
+        }
 
-        return amount_in;
+        uint64_t amount_in = 0;
+        const bool fits = detail::get_amount_in(amount_out, reserve_in, reserve_out, fee, protocol_fee, amount_in);
+        if ( Policy::checked && !fits ) return Policy::error(status::overflow);
+        return Policy::value(amount_in);
     }
 
     /**
@@ -96,6 +707,9 @@ namespace uniswap {
      *
      * Given some amount of an asset and pair reserves, returns an equivalent amount of the other asset
      *
+     * `amount_a * reserve_b` is taken in 128 bits, only a quoted amount above 64 bits is an overflow. Earlier releases
+     * aborted as soon as the 64-bit product overflowed, even when the quoted amount fit.
+     *
      * ### params
      *
      * - `{uint64_t} amount_a` - amount A
@@ -115,11 +729,1535 @@ namespace uniswap {
      * // => 27410
      * ```
      */
-    static uint64_t quote( const uint64_t amount_a, const uint64_t reserve_a, const uint64_t reserve_b )
+    template <class Policy = check_policy>
+    static inline UNISWAP_CONSTEXPR typename Policy::type quote( const uint64_t amount_a, const uint64_t reserve_a, const uint64_t reserve_b )
+    {
+        if ( Policy::checked && ((amount_a == 0) | (reserve_a == 0) | (reserve_b == 0)) ) {
+            return Policy::error(amount_a == 0 ? status::insufficient_amount : status::insufficient_liquidity);
+        }
+        const uint128 amount_b = static_cast<uint128>(amount_a) * reserve_b / reserve_a;
+        if ( Policy::checked && detail::hi(amount_b) ) return Policy::error(status::overflow);
+        return Policy::value(detail::lo(amount_b));
+    }
+
+    /**
+     * ## STATIC `try_get_amount_out`
+     *
+     * `get_amount_out` returning a `result` instead of aborting, same as `<status_policy>`
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - amount input
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint16_t} [fee=30]` - (optional) trade fee (pips 1/100 of 1%)
+     * - `{uint16_t} [protocol_fee=0]` - (optional) trade fee (pips 1/100 of 1%) fee deducted from input amount prior to trade
+     *
+     * ### example
+     *
+     * ```c++
+     * const uniswap::result result = uniswap::try_get_amount_out( 10000, 45851931234, 0 );
+     * // => { amount: 0, code: status::insufficient_liquidity }
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR result try_get_amount_out( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+    {
+        return get_amount_out<status_policy>(amount_in, reserve_in, reserve_out, fee, protocol_fee);
+    }
+
+    /**
+     * ## STATIC `try_get_amount_in`
+     *
+     * `get_amount_in` returning a `result` instead of aborting, same as `<status_policy>`
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_out` - amount output
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint16_t} [fee=30]` - (optional) trading fee (pips 1/100 of 1%)
+     * - `{uint16_t} [protocol_fee=0]` - (optional) trade fee (pips 1/100 of 1%) fee deducted from input amount prior to trade
+     *
+     * ### example
+     *
+     * ```c++
+     * const uniswap::result result = uniswap::try_get_amount_in( 27328, 45851931234, 125682033533 );
+     * // => { amount: 10000, code: status::ok }
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR result try_get_amount_in( const uint64_t amount_out, const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+    {
+        return get_amount_in<status_policy>(amount_out, reserve_in, reserve_out, fee, protocol_fee);
+    }
+
+    /**
+     * ## STATIC `try_quote`
+     *
+     * `quote` returning a `result` instead of aborting, same as `<status_policy>`
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_a` - amount A
+     * - `{uint64_t} reserve_a` - reserve A
+     * - `{uint64_t} reserve_b` - reserve B
+     *
+     * ### example
+     *
+     * ```c++
+     * const uniswap::result result = uniswap::try_quote( 10000, 45851931234, 125682033533 );
+     * // => { amount: 27410, code: status::ok }
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR result try_quote( const uint64_t amount_a, const uint64_t reserve_a, const uint64_t reserve_b )
     {
-        eosio::check(amount_a > 0, "SX.Uniswap: INSUFFICIENT_AMOUNT");
-        eosio::check(reserve_a > 0 && reserve_b > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
-        const uint64_t amount_b = safemath::mul(amount_a, reserve_b) / reserve_a;
-        return amount_b;
+        return quote<status_policy>(amount_a, reserve_a, reserve_b);
+    }
+
+    /**
+     * ## STRUCT `math<T>`
+     *
+     * `get_amount_out`, `get_amount_in` and `quote` over `T` amounts and reserves (`uint32_t`, `uint64_t` or `uint128`)
+     *
+     * - `math<uint64_t>` is the default `uint64_t` API
+     * - `math<uint32_t>` runs on the `uint64_t` kernels, which stay in 64-bit registers for small pools
+     * - `math<uint128>` bounds amounts and reserves by `2^112` (Uniswap V2 `uint112` reserves), so every product fits in the
+     *   256-bit `detail::mul_wide` / `detail::div_wide` intermediates
+     *
+     * Invalid inputs abort through `eosio::check` whatever `T`, the error policies carry `uint64_t` amounts only
+     *
+     * ### example
+     *
+     * ```c++
+     * // 18 decimals
+     * const uniswap::uint128 reserve_in = static_cast<uniswap::uint128>(45851931234) * 100000000000000;
+     * const uniswap::uint128 reserve_out = static_cast<uniswap::uint128>(125682033533) * 100000000000000;
+     * const uniswap::uint128 amount_in = static_cast<uniswap::uint128>(10000) * 100000000000000;
+     *
+     * // Calculation
+     * const uniswap::uint128 amount_out = uniswap::math<uniswap::uint128>::get_amount_out( amount_in, reserve_in, reserve_out );
+     * // => 2732817502205767680
+     * ```
+     */
+    template <class T> struct math;
+
+    template <> struct math<uint64_t> {
+        typedef uint64_t type;
+
+        static inline UNISWAP_CONSTEXPR type get_amount_out( const type amount_in, const type reserve_in, const type reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+        {
+            return uniswap::get_amount_out(amount_in, reserve_in, reserve_out, fee, protocol_fee);
+        }
+
+        static inline UNISWAP_CONSTEXPR type get_amount_in( const type amount_out, const type reserve_in, const type reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+        {
+            return uniswap::get_amount_in(amount_out, reserve_in, reserve_out, fee, protocol_fee);
+        }
+
+        static inline UNISWAP_CONSTEXPR type quote( const type amount_a, const type reserve_a, const type reserve_b )
+        {
+            return uniswap::quote(amount_a, reserve_a, reserve_b);
+        }
+    };
+
+    template <> struct math<uint32_t> {
+        typedef uint32_t type;
+
+        // outputs stay below `reserve_out`
+        static inline UNISWAP_CONSTEXPR type get_amount_out( const type amount_in, const type reserve_in, const type reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+        {
+            return static_cast<type>(uniswap::get_amount_out(amount_in, reserve_in, reserve_out, fee, protocol_fee));
+        }
+
+        static inline UNISWAP_CONSTEXPR type get_amount_in( const type amount_out, const type reserve_in, const type reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+        {
+            const uint64_t amount_in = uniswap::get_amount_in(amount_out, reserve_in, reserve_out, fee, protocol_fee);
+            detail::check((amount_in >> 32) == 0, "SX.Uniswap: OVERFLOW");
+            return static_cast<type>(amount_in);
+        }
+
+        static inline UNISWAP_CONSTEXPR type quote( const type amount_a, const type reserve_a, const type reserve_b )
+        {
+            const uint64_t amount_b = uniswap::quote(amount_a, reserve_a, reserve_b);
+            detail::check((amount_b >> 32) == 0, "SX.Uniswap: OVERFLOW");
+            return static_cast<type>(amount_b);
+        }
+    };
+
+    template <> struct math<uint128> {
+        typedef uint128 type;
+
+        // `uint112` bound
+        static inline UNISWAP_CONSTEXPR bool fits( const type x ) { return (x >> 112) == 0; }
+
+        static inline UNISWAP_CONSTEXPR type protocol_fee_amount( const type amount_in, const uint16_t protocol_fee )
+        {
+            const type amount = amount_in * protocol_fee / 10000;
+            return (protocol_fee && amount == 0) ? type(1) : amount;
+        }
+
+        static inline UNISWAP_CONSTEXPR type get_amount_out( const type amount_in, const type reserve_in, const type reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+        {
+            // checks
+            detail::check(amount_in > 0, "SX.Uniswap: INSUFFICIENT_INPUT_AMOUNT");
+            detail::check(reserve_in > 0 && reserve_out > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+            detail::check(fits(amount_in) && fits(reserve_in) && fits(reserve_out), "SX.Uniswap: OVERFLOW");
+
+            const type fee_amount = protocol_fee_amount(amount_in, protocol_fee);
+            if ( amount_in <= fee_amount ) return 0;
+
+            // `amount_in_with_fee < denominator < 2^127`, numerator below 2^238
+            const type amount_in_with_fee = (amount_in - fee_amount) * static_cast<uint16_t>(10000 - fee);
+            const type denominator = reserve_in * 10000 + amount_in_with_fee;
+            return detail::div_wide(detail::mul_wide(amount_in_with_fee, reserve_out), denominator);
+        }
+
+        static inline UNISWAP_CONSTEXPR type get_amount_in( const type amount_out, const type reserve_in, const type reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+        {
+            // checks
+            detail::check(amount_out > 0, "SX.Uniswap: INSUFFICIENT_OUTPUT_AMOUNT");
+            detail::check(reserve_in > 0 && reserve_out > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+            detail::check(amount_out < reserve_out, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+            detail::check(protocol_fee < 10000, "SX.Uniswap: INVALID_PROTOCOL_FEE");
+            detail::check(fits(reserve_in) && fits(reserve_out), "SX.Uniswap: OVERFLOW");
+
+            // numerator `reserve_in * 10000 * amount_out` below 2^238, inputs beyond `uint112` overflow
+            const detail::uint256 numerator = detail::mul_wide(reserve_in * 10000, amount_out);
+            const type denominator = (reserve_out - amount_out) * static_cast<uint16_t>(10000 - fee);
+            detail::check(numerator.high < denominator, "SX.Uniswap: OVERFLOW");
+            const type amount = detail::div_wide(numerator, denominator) + 1;
+            detail::check(fits(amount), "SX.Uniswap: OVERFLOW");
+            if ( !protocol_fee ) return amount;
+
+            // smallest input whose amount after protocol fees covers `amount`, as `detail::add_protocol_fee`
+            type amount_in = (amount - 1) * 10000 / (10000 - protocol_fee) + 1;
+            detail::check(fits(amount_in), "SX.Uniswap: OVERFLOW");
+            while ( amount_in - protocol_fee_amount(amount_in, protocol_fee) < amount ) amount_in++;
+            detail::check(fits(amount_in), "SX.Uniswap: OVERFLOW");
+            return amount_in;
+        }
+
+        static inline UNISWAP_CONSTEXPR type quote( const type amount_a, const type reserve_a, const type reserve_b )
+        {
+            detail::check(amount_a > 0, "SX.Uniswap: INSUFFICIENT_AMOUNT");
+            detail::check(reserve_a > 0 && reserve_b > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+            detail::check(fits(amount_a) && fits(reserve_a) && fits(reserve_b), "SX.Uniswap: OVERFLOW");
+
+            const detail::uint256 product = detail::mul_wide(amount_a, reserve_b);
+            detail::check(product.high < reserve_a, "SX.Uniswap: OVERFLOW");
+            const type amount_b = detail::div_wide(product, reserve_a);
+            detail::check(fits(amount_b), "SX.Uniswap: OVERFLOW");
+            return amount_b;
+        }
+    };
+
+    /**
+     * ## STATIC `isqrt`
+     *
+     * Returns `floor(sqrt(x))` of a 128-bit value, exact
+     *
+     * Seeded in floating point just above the root, then integer Newton steps `y = (y + x / y) / 2` settle on it (usually one or two)
+     *
+     * ### params
+     *
+     * - `{uint128} x` - value
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t root = uniswap::isqrt( static_cast<uniswap::uint128>(45851931234) * 125682033533 );
+     * // => 75912870838
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR uint64_t isqrt( const uint128 x )
+    {
+        return detail::isqrt(x);
+    }
+
+    namespace detail {
+        // reserve price after selling `amount_in` is at or below `price_numerator / price_denominator`
+        static inline UNISWAP_CONSTEXPR bool reaches_price( const uint64_t amount_in, const uint64_t reserve_in, const uint64_t reserve_out, const uint64_t price_numerator, const uint64_t price_denominator, const uint16_t fee, const uint16_t protocol_fee )
+        {
+            const uint64_t fee_amount = protocol_fee_amount(amount_in, protocol_fee);
+            const uint64_t amount = amount_in > fee_amount ? amount_in - fee_amount : 0;
+            const uint64_t amount_out = get_amount_out(amount_in, reserve_in, reserve_out, fee, protocol_fee);
+            const uint256 price = mul_wide(static_cast<uint128>(reserve_out - amount_out), price_denominator);
+            const uint256 target = mul_wide(static_cast<uint128>(reserve_in) + amount, price_numerator);
+            return !less(target, price);
+        }
+    }
+
+    /**
+     * ## STATIC `get_amount_in_to_price`
+     *
+     * Given pair reserves and a target price, returns the minimal input amount moving `reserve_out / reserve_in` to or below the target
+     *
+     * With `f = 10000 - fee` and target `n / d`, the input reaching the target after protocol fees solves
+     * `f * n * x^2 + n * r_in * (10000 + f) * x - 10000 * r_in * (d * r_out - n * r_in) = 0`:
+     *
+     * `x = (sqrt(n * r_in * (n * r_in * fee^2 + 40000 * f * d * r_out)) - n * r_in * (10000 + f)) / (2 * f * n)`
+     *
+     * The closed form lands next to the answer (`get_amount_out` rounding shifts it by a few units), a doubling search around it
+     * with exact integer checks settles the minimal amount in at most 128 probes, whatever the estimate.
+     *
+     * ### params
+     *
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint64_t} price_numerator` - target price numerator (`reserve_out` units)
+     * - `{uint64_t} price_denominator` - target price denominator (`reserve_in` units)
+     * - `{uint16_t} [fee=30]` - (optional) trade fee (pips 1/100 of 1%)
+     * - `{uint16_t} [protocol_fee=0]` - (optional) protocol fee (pips 1/100 of 1%) deducted from input amount prior to trade
+     *
+     * ### returns
+     *
+     * - `{uint64_t}` - amount input, `0` if the price is already at or below the target
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t reserve_in = 100000000;
+     * const uint64_t reserve_out = 400000000;
+     *
+     * // Calculation: move the price from 4 down to 3.9
+     * const uint64_t amount_in = uniswap::get_amount_in_to_price( reserve_in, reserve_out, 39, 10 );
+     * // => 1275851
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR uint64_t get_amount_in_to_price( const uint64_t reserve_in, const uint64_t reserve_out, const uint64_t price_numerator, const uint64_t price_denominator, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+    {
+        detail::check(reserve_in > 0 && reserve_out > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+        detail::check(price_numerator > 0 && price_denominator > 0, "SX.Uniswap: INVALID_PRICE");
+        detail::check(fee < 10000 && protocol_fee < 10000, "SX.Uniswap: INVALID_FEE");
+        if ( detail::reaches_price(0, reserve_in, reserve_out, price_numerator, price_denominator, fee, protocol_fee) ) return 0;
+
+        // closed form, sqrt(x * d) with d truncated to 128 bits by an even shift
+        const uint64_t f = 10000 - fee;
+        const uint128 x = static_cast<uint128>(price_numerator) * reserve_in;
+        const detail::uint256 d = detail::add(detail::mul_wide(x, static_cast<uint128>(fee) * fee), detail::mul_wide(static_cast<uint128>(price_denominator) * reserve_out, static_cast<uint128>(40000) * f));
+        int shift = detail::bits(d) > 128 ? detail::bits(d) - 128 : 0;
+        if ( shift % 2 ) shift++;
+        const uint128 root = detail::isqrt(detail::mul_wide(x, detail::shr(d, shift).low));
+        const detail::uint256 scaled_root = detail::shl(detail::uint256{ 0, root }, shift / 2);
+        const detail::uint256 base = detail::mul_wide(x, 10000 + f);
+        const uint128 denominator = static_cast<uint128>(2 * f) * price_numerator;
+
+        uint64_t amount = 1;
+        if ( detail::less(base, scaled_root) ) {
+            const detail::uint256 numerator = detail::sub(scaled_root, base);
+            const uint128 estimate = numerator.high >= denominator ? ~uint128(0) : detail::div_wide(numerator, denominator);
+            amount = detail::hi(estimate) ? ~uint64_t(0) : (detail::lo(estimate) ? detail::lo(estimate) : 1);
+        }
+        uint64_t upper = ~uint64_t(0);
+        if ( !detail::add_protocol_fee(amount, protocol_fee, upper) ) upper = ~uint64_t(0);
+
+        // bracket (lower, upper] around the estimate with doubling steps, then bisect to the minimal amount
+        //
+        // Bound: both gallops probe steps 1, 2, 4, ... 2^63 at most, since the steps walked so far sum to 2^j - 1 and the
+        // bracket end stays inside uint64_t (upward, `lower` reaches 2^64 - 1 and aborts; downward, `step < upper` fails).
+        // The bracket left behind is at most the last step wide, <= 2^63, so bisection adds at most 63 probes:
+        // 1 + 64 + 63 = 128 `reaches_price` probes in total, independent of how far off the closed form is.
+        uint64_t lower = 0;
+        int probes = 1;
+        if ( detail::reaches_price(upper, reserve_in, reserve_out, price_numerator, price_denominator, fee, protocol_fee) ) {
+            for ( uint64_t step = 1; step < upper; step *= 2 ) {
+                probes++;
+                if ( !detail::reaches_price(upper - step, reserve_in, reserve_out, price_numerator, price_denominator, fee, protocol_fee) ) {
+                    lower = upper - step;
+                    break;
+                }
+                upper -= step;
+            }
+        } else {
+            lower = upper;
+            for ( uint64_t step = 1; ; step *= 2 ) {
+                detail::check(lower != ~uint64_t(0), "SX.Uniswap: OVERFLOW");
+                upper = ~uint64_t(0) - lower > step ? lower + step : ~uint64_t(0);
+                probes++;
+                if ( detail::reaches_price(upper, reserve_in, reserve_out, price_numerator, price_denominator, fee, protocol_fee) ) break;
+                lower = upper;
+            }
+        }
+        while ( upper - lower > 1 ) {
+            const uint64_t middle = lower + (upper - lower) / 2;
+            probes++;
+            if ( detail::reaches_price(middle, reserve_in, reserve_out, price_numerator, price_denominator, fee, protocol_fee) ) upper = middle;
+            else lower = middle;
+        }
+        detail::check(probes <= 128, "SX.Uniswap: PRICE_SEARCH_BOUND");
+        return upper;
+    }
+
+    /**
+     * ## STATIC `get_amount_out_batch`
+     *
+     * Evaluates `get_amount_out` over contiguous arrays, flagging invalid lanes instead of aborting the whole batch
+     *
+     * ### params
+     *
+     * - `{const uint64_t*} amount_in` - amounts input
+     * - `{const uint64_t*} reserve_in` - reserves input
+     * - `{const uint64_t*} reserve_out` - reserves output
+     * - `{const uint16_t*} fee` - trade fees (pips 1/100 of 1%)
+     * - `{size_t} size` - number of lanes
+     * - `{uint64_t*} amount_out` - (output) amounts output, `0` for invalid lanes
+     * - `{uint8_t*} errors` - (output) error mask, `1` for lanes failing `get_amount_out` checks
+     *
+     * ### returns
+     *
+     * - `{size_t}` - number of invalid lanes
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t amount_in[] = { 10000, 10000, 10000 };
+     * const uint64_t reserve_in[] = { 45851931234, 100000000, 0 };
+     * const uint64_t reserve_out[] = { 125682033533, 400000000, 400000000 };
+     * const uint16_t fee[] = { 30, 30, 30 };
+     *
+     * // Calculation
+     * uint64_t amount_out[3];
+     * uint8_t errors[3];
+     * const size_t failed = uniswap::get_amount_out_batch( amount_in, reserve_in, reserve_out, fee, 3, amount_out, errors );
+     * // => amount_out = { 27328, 39876, 0 }, errors = { 0, 0, 1 }, failed = 1
+     * ```
+     */
+    static inline size_t get_amount_out_batch( const uint64_t* amount_in, const uint64_t* reserve_in, const uint64_t* reserve_out, const uint16_t* fee, const size_t size, uint64_t* amount_out, uint8_t* errors )
+    {
+        // validation pass is branch-free so it vectorizes
+        size_t failed = 0;
+        for ( size_t i = 0; i < size; i++ ) {
+            const uint8_t error = (amount_in[i] == 0) | (reserve_in[i] == 0) | (reserve_out[i] == 0);
+            errors[i] = error;
+            failed += error;
+        }
+
+        // invalid lanes are quoted against a non-zero reserve and masked out
+        for ( size_t i = 0; i < size; i++ ) {
+            const uint64_t out = detail::get_amount_out(amount_in[i], reserve_in[i] | errors[i], reserve_out[i], fee[i], 0);
+            amount_out[i] = errors[i] ? 0 : out;
+        }
+        return failed;
+    }
+
+    /**
+     * ## STRUCT `prepared_pool`
+     *
+     * Pair reserves and fees with constants precomputed for repeated `get_amount_out` quotes against unchanged reserves
+     *
+     * ### params
+     *
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint16_t} [fee=30]` - (optional) trade fee (pips 1/100 of 1%)
+     * - `{uint16_t} [protocol_fee=0]` - (optional) trade fee (pips 1/100 of 1%) fee deducted from input amount prior to trade
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t reserve_in = 45851931234;
+     * const uint64_t reserve_out = 125682033533;
+     * const uniswap::prepared_pool pool( reserve_in, reserve_out, 30 );
+     *
+     * // Calculation
+     * const uint64_t amount_out = pool.get_amount_out( 10000 );
+     * // => 27328
+     * ```
+     */
+    struct prepared_pool {
+        uint64_t reserve_in;
+        uint64_t reserve_out;
+        uint16_t fee;
+        uint16_t protocol_fee;
+
+        // reserve_in * 10000
+        uint128 reserve_in_scaled;
+
+        // 10000 - fee
+        uint16_t fee_multiplier;
+
+        // widest amount_in_with_fee keeping `amount_in_with_fee * reserve_out` within 128 bits
+        int fast_bits;
+
+        // widest amount_in on the 64-bit fast path of `detail::get_amount_out_with_fee`, -1 when `reserve_in` rules it out
+        int fast_bits_64;
+
+        UNISWAP_CONSTEXPR prepared_pool( const uint64_t reserve_in, const uint64_t reserve_out, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+            : reserve_in(reserve_in)
+            , reserve_out(reserve_out)
+            , fee(fee)
+            , protocol_fee(protocol_fee)
+            , reserve_in_scaled(static_cast<uint128>(reserve_in) * 10000)
+            , fee_multiplier(10000 - fee)
+            , fast_bits(128 - detail::bits(reserve_out))
+            , fast_bits_64((reserve_in >> 49) == 0 ? 64 - detail::bits(reserve_out | 1) - detail::bits(static_cast<uint64_t>(static_cast<uint16_t>(10000 - fee))) : -1)
+        {
+            detail::check(reserve_in > 0 && reserve_out > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+            detail::check(fee < 10000, "SX.Uniswap: INVALID_FEE");
+        }
+
+        /**
+         * ## `get_amount_out`
+         *
+         * Same result as `uniswap::get_amount_out<Policy>( amount_in, reserve_in, reserve_out, fee, protocol_fee )`, reserves are
+         * checked once by the constructor
+         */
+        template <class Policy = check_policy>
+        UNISWAP_CONSTEXPR typename Policy::type get_amount_out( const uint64_t amount_in ) const
+        {
+            if ( Policy::checked && amount_in == 0 ) return Policy::error(status::insufficient_input_amount);
+
+            const uint64_t protocol_fee_amount = protocol_fee ? detail::protocol_fee_amount(amount_in, protocol_fee) : 0;
+            if ( amount_in <= protocol_fee_amount ) return Policy::value(0);
+            const uint64_t amount = amount_in - protocol_fee_amount;
+
+            // same 64-bit fast path as `detail::get_amount_out_with_fee`
+            if ( detail::bits(amount) <= fast_bits_64 ) {
+                const uint64_t amount_in_with_fee_64 = amount * fee_multiplier;
+                return Policy::value(amount_in_with_fee_64 * reserve_out / (reserve_in * 10000 + amount_in_with_fee_64));
+            }
+
+            const uint128 amount_in_with_fee = static_cast<uint128>(amount) * fee_multiplier;
+            const uint128 denominator = reserve_in_scaled + amount_in_with_fee;
+            if ( detail::bits(amount_in_with_fee) <= fast_bits ) return Policy::value(static_cast<uint64_t>( amount_in_with_fee * reserve_out / denominator ));
+            return Policy::value(detail::mul_div_wide(amount_in_with_fee, reserve_out, denominator));
+        }
+    };
+
+    /**
+     * ## STRUCT `hop`
+     *
+     * Pool reserves and fees for one swap along a path
+     *
+     * - `{uint64_t} reserve_in` - reserve input
+     * - `{uint64_t} reserve_out` - reserve output
+     * - `{uint16_t} fee` - trade fee (pips 1/100 of 1%)
+     * - `{uint16_t} protocol_fee` - trade fee (pips 1/100 of 1%) fee deducted from input amount prior to trade
+     */
+    struct hop {
+        uint64_t reserve_in;
+        uint64_t reserve_out;
+        uint16_t fee;
+        uint16_t protocol_fee;
+    };
+
+    namespace detail {
+        // checks shared by `get_amounts_out` overloads
+        static inline UNISWAP_CONSTEXPR status check_path( const uint64_t amount_in, const hop* path, const size_t size )
+        {
+            bool liquidity = true;
+            bool fees = true;
+            for ( size_t i = 0; i < size; i++ ) {
+                liquidity &= path[i].reserve_in > 0 && path[i].reserve_out > 0;
+                fees &= path[i].fee < 10000;
+            }
+            return size == 0 ? status::invalid_path : amount_in == 0 ? status::insufficient_input_amount : !liquidity ? status::insufficient_liquidity : !fees ? status::invalid_fee : status::ok;
+        }
+
+        // `get_amounts_out` hops unrolled at compile time
+        template <size_t i, size_t size>
+        struct amounts_out {
+            static UNISWAP_CONSTEXPR void apply( const hop* path, uint64_t* amounts )
+            {
+                amounts[i + 1] = get_amount_out(amounts[i], path[i].reserve_in, path[i].reserve_out, path[i].fee, path[i].protocol_fee);
+                amounts_out<i + 1, size>::apply(path, amounts);
+            }
+        };
+
+        template <size_t size>
+        struct amounts_out<size, size> {
+            static UNISWAP_CONSTEXPR void apply( const hop*, uint64_t* ) {}
+        };
+    }
+
+    /**
+     * ## STATIC `get_amounts_out`
+     *
+     * Given an input amount and a path of pools, returns the output amount of every hop (UniswapV2Library `getAmountsOut`)
+     *
+     * Takes an error policy as `get_amount_out`, an empty path reports `status::invalid_path`
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - amount input
+     * - `{const hop*} path` - pools along the path
+     * - `{size_t} size` - number of hops
+     * - `{uint64_t*} amounts` - (output) `size + 1` amounts, `amounts[0]` is `amount_in`
+     *
+     * ### returns
+     *
+     * - `{uint64_t}` - final output amount (`amounts[size]`)
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t amount_in = 10000;
+     * const uniswap::hop path[] = {
+     *     { 100000000, 400000000, 30, 0 },
+     *     { 400000000, 100000000, 30, 0 }
+     * };
+     *
+     * // Calculation
+     * uint64_t amounts[3];
+     * const uint64_t amount_out = uniswap::get_amounts_out( amount_in, path, 2, amounts );
+     * // => amounts = { 10000, 39876, 9938 }
+     * ```
+     */
+    template <class Policy = check_policy>
+    static inline UNISWAP_CONSTEXPR typename Policy::type get_amounts_out( const uint64_t amount_in, const hop* path, const size_t size, uint64_t* amounts )
+    {
+        const status code = Policy::checked ? detail::check_path(amount_in, path, size) : status::ok;
+        if ( code != status::ok ) return Policy::error(code);
+
+        amounts[0] = amount_in;
+        for ( size_t i = 0; i < size; i++ ) {
+            amounts[i + 1] = detail::get_amount_out(amounts[i], path[i].reserve_in, path[i].reserve_out, path[i].fee, path[i].protocol_fee);
+        }
+
+        // zero amounts propagate, only the last hop may output nothing
+        if ( Policy::checked && amounts[size - 1] == 0 ) return Policy::error(status::insufficient_input_amount);
+        return Policy::value(amounts[size]);
+    }
+
+    /**
+     * ## STATIC `get_amounts_out<size>`
+     *
+     * `get_amounts_out` for a path length known at compile time, hops are unrolled
+     *
+     * ### example
+     *
+     * ```c++
+     * uint64_t amounts[3];
+     * const uint64_t amount_out = uniswap::get_amounts_out( amount_in, path, amounts );
+     * ```
+     */
+    template <class Policy = check_policy, size_t size>
+    static inline UNISWAP_CONSTEXPR typename Policy::type get_amounts_out( const uint64_t amount_in, const hop (&path)[size], uint64_t (&amounts)[size + 1] )
+    {
+        const status code = Policy::checked ? detail::check_path(amount_in, path, size) : status::ok;
+        if ( code != status::ok ) return Policy::error(code);
+
+        amounts[0] = amount_in;
+        detail::amounts_out<0, size>::apply(path, amounts);
+
+        // zero amounts propagate, only the last hop may output nothing
+        if ( Policy::checked && amounts[size - 1] == 0 ) return Policy::error(status::insufficient_input_amount);
+        return Policy::value(amounts[size]);
+    }
+
+    /**
+     * ## STATIC `get_amounts_in`
+     *
+     * Given an output amount and a path of pools, returns the input amount of every hop (UniswapV2Library `getAmountsIn`)
+     *
+     * Hops are walked backwards through `get_amount_in`, each input covers the next hop's output,
+     * so `get_amounts_out( amounts[0], path, ... )` is guaranteed to return at least `amount_out`
+     *
+     * Takes an error policy as `get_amount_in`, an empty path reports `status::invalid_path`
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_out` - amount output
+     * - `{const hop*} path` - pools along the path
+     * - `{size_t} size` - number of hops
+     * - `{uint64_t*} amounts` - (output) `size + 1` amounts, `amounts[size]` is `amount_out`
+     *
+     * ### returns
+     *
+     * - `{uint64_t}` - required input amount (`amounts[0]`)
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uint64_t amount_out = 9938;
+     * const uniswap::hop path[] = {
+     *     { 100000000, 400000000, 30, 0 },
+     *     { 400000000, 100000000, 30, 0 }
+     * };
+     *
+     * // Calculation
+     * uint64_t amounts[3];
+     * const uint64_t amount_in = uniswap::get_amounts_in( amount_out, path, 2, amounts );
+     * // => amounts = { 10000, 39876, 9938 }
+     * ```
+     */
+    template <class Policy = check_policy>
+    static inline UNISWAP_CONSTEXPR typename Policy::type get_amounts_in( const uint64_t amount_out, const hop* path, const size_t size, uint64_t* amounts )
+    {
+        if ( Policy::checked && ((size == 0) | (amount_out == 0)) ) {
+            return Policy::error(size == 0 ? status::invalid_path : status::insufficient_output_amount);
+        }
+
+        amounts[size] = amount_out;
+        for ( size_t i = size; i > 0; i-- ) {
+            const hop& pool = path[i - 1];
+            // same checks as `get_amount_in`, `amounts[i] > 0` holds once the output hop is covered
+            if ( Policy::checked && ((pool.reserve_in == 0) | (amounts[i] >= pool.reserve_out) | (pool.fee >= 10000) | (pool.protocol_fee >= 10000)) ) {
+                return Policy::error(pool.reserve_in == 0 || amounts[i] >= pool.reserve_out ? status::insufficient_liquidity : pool.fee >= 10000 ? status::invalid_fee : status::invalid_protocol_fee);
+            }
+            const bool fits = detail::get_amount_in(amounts[i], pool.reserve_in, pool.reserve_out, pool.fee, pool.protocol_fee, amounts[i - 1]);
+            if ( Policy::checked && !fits ) return Policy::error(status::overflow);
+        }
+        return Policy::value(amounts[0]);
+    }
+
+    /**
+     * ## STATIC `get_amounts_in<size>`
+     *
+     * `get_amounts_in` for a path length known at compile time
+     *
+     * ### example
+     *
+     * ```c++
+     * uint64_t amounts[3];
+     * const uint64_t amount_in = uniswap::get_amounts_in( amount_out, path, amounts );
+     * ```
+     */
+    template <class Policy = check_policy, size_t size>
+    static inline UNISWAP_CONSTEXPR typename Policy::type get_amounts_in( const uint64_t amount_out, const hop (&path)[size], uint64_t (&amounts)[size + 1] )
+    {
+        return get_amounts_in<Policy>(amount_out, path, size, amounts);
+    }
+
+    namespace detail {
+        // unchecked `get_amounts_out` returning only the final amount
+        static inline UNISWAP_CONSTEXPR uint64_t get_amounts_out( uint64_t amount, const hop* path, const size_t size )
+        {
+            for ( size_t i = 0; i < size; i++ ) amount = get_amount_out(amount, path[i].reserve_in, path[i].reserve_out, path[i].fee, path[i].protocol_fee);
+            return amount;
+        }
+
+        // smallest input whose output along `path` covers `amount_out`, returns false when out of reach or beyond 64 bits
+        // (`get_amount_in` can overshoot by a unit per hop, each hop steps back to its cheapest input)
+        static inline UNISWAP_CONSTEXPR bool get_cheapest_amount_in( const uint64_t amount_out, const hop* path, const size_t size, uint64_t& amount_in )
+        {
+            uint64_t amount = amount_out;
+            for ( size_t i = size; i > 0; i-- ) {
+                const hop& pool = path[i - 1];
+                const uint64_t target = amount;
+                if ( target >= pool.reserve_out || !get_amount_in(target, pool.reserve_in, pool.reserve_out, pool.fee, pool.protocol_fee, amount) ) return false;
+                while ( amount > 1 && get_amount_out(amount - 1, pool.reserve_in, pool.reserve_out, pool.fee, pool.protocol_fee) >= target ) amount--;
+            }
+            amount_in = amount;
+            return true;
+        }
+
+        // integer optimum around a real-valued `estimate` of a cyclic `path`: floored outputs make the profit a step function
+        // whose cheapest input for the estimate's output can sit far below the estimate, so the cheapest inputs of that output
+        // and its neighbours are compared (ties keep the smaller input), within one unit of the best profit
+        static inline UNISWAP_CONSTEXPR uint64_t refine_arbitrage_amount_in( const uint64_t estimate, const hop* path, const size_t size )
+        {
+            const uint64_t target = get_amounts_out(estimate, path, size);
+            uint64_t best = 0;
+            uint64_t best_profit = 0;
+            for ( uint64_t amount_out = target > 1 ? target - 1 : 1; amount_out <= target + 1 && amount_out != 0; amount_out++ ) {
+                uint64_t amount_in = 0;
+                if ( !get_cheapest_amount_in(amount_out, path, size, amount_in) ) continue;
+                const uint64_t out = get_amounts_out(amount_in, path, size);
+                if ( out > amount_in && (out - amount_in > best_profit || (out - amount_in == best_profit && amount_in < best)) ) {
+                    best = amount_in;
+                    best_profit = out - amount_in;
+                }
+            }
+            return best;
+        }
+    }
+
+    /**
+     * ## STATIC `get_arbitrage_amount_in`
+     *
+     * Given two pools of the same pair, returns the input amount maximizing the profit of swapping
+     * token A into token B through `buy` and token B back into token A through `sell`
+     *
+     * The optimum of the constant-product curves is computed in closed form with an integer square root,
+     * `(sqrt(f1 * f2 * r1 * r2 * s1 * s2) - 10000 * r1 * r2) * 10000 / (f1 * (10000 * r2 + f2 * s1))`,
+     * then snapped to the cheapest input reaching the same output (`get_amount_in` back along both hops) and compared with
+     * the cheapest inputs of the neighbouring outputs. The profit is within one unit of the best integer profit: near the
+     * optimum the profit is flat and a one unit better input can sit anywhere on that plateau.
+     *
+     * The root is exact when each pool's `fee_multiplier * reserve_in * reserve_out` fits in 128 bits,
+     * otherwise the lowest bits of the intermediates are truncated (error well below one unit of input),
+     * protocol fees are folded into the fee multipliers
+     *
+     * ### params
+     *
+     * - `{hop} buy` - pool swapping token A (`reserve_in`) into token B (`reserve_out`)
+     * - `{hop} sell` - pool swapping token B (`reserve_in`) into token A (`reserve_out`)
+     *
+     * ### returns
+     *
+     * - `{uint64_t}` - optimal amount of token A, `0` if no trade is profitable
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uniswap::hop buy = { 1000000000, 2000000000, 30, 0 };
+     * const uniswap::hop sell = { 1900000000, 1050000000, 30, 0 };
+     *
+     * // Calculation
+     * const uint64_t amount_in = uniswap::get_arbitrage_amount_in( buy, sell );
+     * // => 23569923
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR uint64_t get_arbitrage_amount_in( const hop& buy, const hop& sell )
+    {
+        detail::check(buy.reserve_in > 0 && buy.reserve_out > 0 && sell.reserve_in > 0 && sell.reserve_out > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+        detail::check(buy.protocol_fee < 10000 && sell.protocol_fee < 10000, "SX.Uniswap: INVALID_PROTOCOL_FEE");
+
+        // protocol fees folded into the fee multipliers
+        const uint64_t f1 = static_cast<uint64_t>(10000 - buy.fee) * (10000 - buy.protocol_fee) / 10000;
+        const uint64_t f2 = static_cast<uint64_t>(10000 - sell.fee) * (10000 - sell.protocol_fee) / 10000;
+
+        // sqrt(f1 * r1 * s1 * f2 * r2 * s2), factors are truncated to 128 bits with an even total shift
+        const detail::uint256 a = detail::mul_wide(static_cast<uint128>(buy.reserve_in) * buy.reserve_out, f1);
+        const detail::uint256 b = detail::mul_wide(static_cast<uint128>(sell.reserve_in) * sell.reserve_out, f2);
+        int shift_a = detail::bits(a) > 128 ? detail::bits(a) - 128 : 0;
+        const int shift_b = detail::bits(b) > 128 ? detail::bits(b) - 128 : 0;
+        if ( (shift_a + shift_b) % 2 ) shift_a++;
+        const uint128 root = detail::isqrt(detail::mul_wide(detail::shr(a, shift_a).low, detail::shr(b, shift_b).low));
+        const detail::uint256 scaled_root = detail::shl(detail::uint256{ 0, root }, (shift_a + shift_b) / 2);
+
+        // unprofitable unless f1 * f2 * s1 * s2 > 10000^2 * r1 * r2
+        const detail::uint256 base = detail::mul_wide(static_cast<uint128>(buy.reserve_in) * sell.reserve_in, 10000);
+        if ( !detail::less(base, scaled_root) ) return 0;
+
+        const detail::uint256 difference = detail::sub(scaled_root, base);
+        const uint128 denominator = static_cast<uint128>(f1) * (static_cast<uint128>(sell.reserve_in) * 10000 + static_cast<uint128>(f2) * buy.reserve_out);
+        // difference exceeds 128 bits only for reserves near 2^64, both terms are then scaled down
+        const int scale = detail::bits(difference) > 128 ? detail::bits(difference) - 128 : 0;
+        uint64_t estimate = ~uint64_t(0);
+        if ( (denominator >> scale) == 0 || !detail::try_mul_div(detail::shr(difference, scale).low, 10000, denominator >> scale, estimate) ) estimate = ~uint64_t(0);
+        if ( estimate == 0 ) estimate = 1;
+
+        const hop path[] = { buy, sell };
+        return detail::refine_arbitrage_amount_in(estimate, path, 2);
+    }
+
+    /**
+     * ## STRUCT `route`
+     *
+     * Multi-hop path folded into one virtual constant-product pool (see `compile_route`)
+     *
+     * - `{const hop*} path` - pools along the path (not owned, must outlive the route)
+     * - `{size_t} size` - number of hops
+     * - `{uint64_t} reserve_in` - virtual reserve input (rounded down)
+     * - `{uint64_t} reserve_out` - virtual reserve output (rounded up)
+     * - `{uint16_t} fee` - trade fee of the first hop (pips 1/100 of 1%)
+     * - `{uint16_t} protocol_fee` - protocol fee of the first hop (pips 1/100 of 1%)
+     * - `{uint64_t} error` - bound on the virtual quote exceeding the exact per-hop chain
+     */
+    struct route {
+        const hop* path;
+        size_t size;
+        uint64_t reserve_in;
+        uint64_t reserve_out;
+        uint16_t fee;
+        uint16_t protocol_fee;
+        uint64_t error;
+
+        /**
+         * ## `get_amount_out`
+         *
+         * Quotes the whole path with a single `get_amount_out` evaluation against the virtual reserves,
+         * within `error` of `get_amounts_out( amount_in, path, size, amounts )` and never below it unless later hops charge a protocol fee
+         *
+         * `exact=true` falls back to walking every hop, returning exactly `get_amounts_out`
+         *
+         * Takes an error policy as `uniswap::get_amount_out`, the path is checked once by `compile_route`
+         */
+        template <class Policy = check_policy>
+        UNISWAP_CONSTEXPR typename Policy::type get_amount_out( const uint64_t amount_in, const bool exact = false ) const
+        {
+            if ( Policy::checked && amount_in == 0 ) return Policy::error(status::insufficient_input_amount);
+            if ( !exact ) return Policy::value(detail::get_amount_out(amount_in, reserve_in, reserve_out, fee, protocol_fee));
+
+            uint64_t amount = amount_in;
+            for ( size_t i = 0; i < size; i++ ) {
+                amount = detail::get_amount_out(amount, path[i].reserve_in, path[i].reserve_out, path[i].fee, path[i].protocol_fee);
+            }
+            return Policy::value(amount);
+        }
+    };
+
+    namespace detail {
+        // `ceil(a * b / c)` saturated to 64 bits, for error bounds
+        static inline UNISWAP_CONSTEXPR uint64_t mul_div_ceil_saturate( const uint64_t a, const uint64_t b, const uint64_t c )
+        {
+            const uint128 q = (static_cast<uint128>(a) * b + c - 1) / c;
+            return hi(q) ? ~uint64_t(0) : lo(q);
+        }
+
+        static inline UNISWAP_CONSTEXPR uint64_t add_saturate( const uint64_t a, const uint64_t b )
+        {
+            return a + b < a ? ~uint64_t(0) : a + b;
+        }
+    }
+
+    /**
+     * ## STATIC `compile_route`
+     *
+     * Folds a path of pools into one virtual pool, chained constant-product swaps compose into a single curve
+     *
+     * Appending hop `(r, s, f)` to virtual reserves `(R_in, R_out)`:
+     *
+     * - `R_in' = floor(10000 * r * R_in / (10000 * r + f * R_out))`
+     * - `R_out' = floor(f * s * R_out / (10000 * r + f * R_out)) + 1`
+     *
+     * Rounding keeps the virtual curve above the exact per-hop chain, the quote never undershoots and exceeds it by at most `error`,
+     * with hop `i` swapping token `i` into `i + 1` and `P_i` the spot rate from token `i` to the final token (`P_k = 1`),
+     * `error = 1 + sum(P_i, i = 1..k) + sum(P_i, i = 2..k) + (k - 1) * P_0 + sum(P_i, hops i >= 1 with protocol fee)`
+     * (chain floors, `reserve_out` rounding, `reserve_in` rounding, protocol fee rounding).
+     *
+     * Protocol fees after the first hop are folded into the fee multiplier, their per-swap rounding can land the quote
+     * below the chain as well, within the same `error`. Use `exact=true` when the last unit matters.
+     *
+     * ### params
+     *
+     * - `{const hop*} path` - pools along the path
+     * - `{size_t} size` - number of hops
+     *
+     * ### returns
+     *
+     * - `{route}` - virtual pool quoting the path
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uniswap::hop path[] = {
+     *     { 100000000, 400000000, 30, 0 },
+     *     { 400000000, 100000000, 30, 0 }
+     * };
+     *
+     * // Calculation
+     * const uniswap::route route = uniswap::compile_route( path, 2 );
+     * const uint64_t amount_out = route.get_amount_out( 1000000 );
+     * // => 974604 (virtual reserves 50075112 / 49924888, error 8)
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR route compile_route( const hop* path, const size_t size )
+    {
+        detail::check(size > 0, "SX.Uniswap: INVALID_PATH");
+        for ( size_t i = 0; i < size; i++ ) {
+            detail::check(path[i].reserve_in > 0 && path[i].reserve_out > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+            detail::check(path[i].fee < 10000 && path[i].protocol_fee < 10000, "SX.Uniswap: INVALID_FEE");
+        }
+
+        route result = { path, size, path[0].reserve_in, path[0].reserve_out, path[0].fee, path[0].protocol_fee, 0 };
+        for ( size_t i = 1; i < size; i++ ) {
+            // both fees as one multiplier out of 10000^2
+            const uint64_t fee_multiplier = static_cast<uint64_t>(10000 - path[i].fee) * (10000 - path[i].protocol_fee);
+            const uint128 reserve_in_scaled = static_cast<uint128>(path[i].reserve_in) * 100000000;
+            const uint128 denominator = reserve_in_scaled + static_cast<uint128>(fee_multiplier) * result.reserve_out;
+
+            result.reserve_in = detail::mul_div(reserve_in_scaled, result.reserve_in, denominator);
+            result.reserve_out = detail::mul_div(static_cast<uint128>(fee_multiplier) * result.reserve_out, path[i].reserve_out, denominator) + 1;
+        }
+
+        // spot rates to the final token, walking backwards: P_k = 1, P_i = ceil(P_(i+1) * (10000 - fee) * s / (10000 * r))
+        uint64_t error = 1;
+        uint64_t rate = 1;
+        for ( size_t i = size; i > 0; i-- ) {
+            const hop& pool = path[i - 1];
+            error = detail::add_saturate(error, rate);                                  // floor of hop i - 1 output
+            if ( i > 1 ) error = detail::add_saturate(error, rate);                     // reserve_out rounding of step i - 1
+            rate = detail::mul_div_ceil_saturate(rate, 10000 - pool.fee, 10000);
+            rate = detail::mul_div_ceil_saturate(rate, pool.reserve_out, pool.reserve_in);
+            if ( i - 1 > 0 && pool.protocol_fee ) error = detail::add_saturate(error, rate);   // protocol fee rounding, in hop i - 1 input
+        }
+        // reserve_in rounding of every step
+        for ( size_t i = 1; i < size; i++ ) {
+            error = detail::add_saturate(error, rate);
+        }
+        result.error = error;
+        return result;
+    }
+
+    /**
+     * ## STATIC `get_arbitrage_amount_in`
+     *
+     * Given a compiled route starting and ending with the same token, returns the input amount maximizing `amount_out - amount_in`
+     *
+     * The virtual pool optimum `(sqrt(10000 * f * R_in * R_out) - 10000 * R_in) / f` is refined on the exact per-hop chain
+     * as in the two pool `get_arbitrage_amount_in`: snapped to the cheapest input reaching the same output (`get_amount_in`
+     * back along every hop) and compared with the cheapest inputs of the neighbouring outputs, within one unit per hop of
+     * the best integer profit. `0` when no trade is profitable.
+     *
+     * ### params
+     *
+     * - `{route} cycle` - route from `compile_route` whose last hop outputs the first hop input token
+     *
+     * ### returns
+     *
+     * - `{uint64_t}` - amount of the cycle token, `0` if no trade is profitable
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uniswap::hop path[] = {
+     *     { 1000000000, 2000000000, 30, 0 },
+     *     { 1900000000, 1050000000, 30, 0 }
+     * };
+     *
+     * // Calculation
+     * const uint64_t amount_in = uniswap::get_arbitrage_amount_in( uniswap::compile_route( path, 2 ) );
+     * // => 23569923
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR uint64_t get_arbitrage_amount_in( const route& cycle )
+    {
+        detail::check(cycle.protocol_fee < 10000, "SX.Uniswap: INVALID_PROTOCOL_FEE");
+
+        // protocol fee folded into the fee multiplier
+        const uint64_t f = static_cast<uint64_t>(10000 - cycle.fee) * (10000 - cycle.protocol_fee) / 10000;
+        if ( f == 0 || cycle.reserve_in == 0 ) return 0;
+
+        // unprofitable unless f * R_out > 10000 * R_in
+        const uint128 root = detail::isqrt(detail::mul_wide(static_cast<uint128>(cycle.reserve_in) * cycle.reserve_out, static_cast<uint128>(f) * 10000));
+        const uint128 base = static_cast<uint128>(cycle.reserve_in) * 10000;
+        if ( root <= base ) return 0;
+
+        const uint128 estimate = (root - base) / f;
+        const uint64_t amount_in = detail::hi(estimate) ? ~uint64_t(0) : (detail::lo(estimate) ? detail::lo(estimate) : 1);
+        return detail::refine_arbitrage_amount_in(amount_in, cycle.path, cycle.size);
+    }
+
+    namespace detail {
+        // fee multiplier out of 10000, protocol fee folded in
+        static inline double split_multiplier( const hop& pool )
+        {
+            return (10000.0 - pool.fee) * (10000.0 - pool.protocol_fee) / 10000.0;
+        }
+
+        // marginal output `m * s * R / (R + m * amount)^2` with `R = 10000 * reserve_in`
+        static inline double marginal_amount_out( const hop& pool, const double amount )
+        {
+            const double m = split_multiplier(pool);
+            const double reserve_in = 10000.0 * pool.reserve_in;
+            const double denominator = reserve_in + m * amount;
+            return m * pool.reserve_out * reserve_in / (denominator * denominator);
+        }
+
+        // `uint128` to and from double, plain arithmetic for every backend
+        static inline double to_double( const uint128 x )
+        {
+            return static_cast<double>(hi(x)) * 18446744073709551616.0 + static_cast<double>(lo(x));
+        }
+
+        // requires `0 <= x < 2^128`
+        static inline uint128 from_double( const double x )
+        {
+            const uint64_t high = static_cast<uint64_t>(x / 18446744073709551616.0);
+            return make_uint128(high, static_cast<uint64_t>(x - static_cast<double>(high) * 18446744073709551616.0));
+        }
+
+        // both fees as one multiplier `M` out of 10000^2
+        static inline uint64_t split_fee_multiplier( const hop& pool )
+        {
+            return static_cast<uint64_t>(10000 - pool.fee) * (10000 - pool.protocol_fee);
+        }
+
+        // `g = sqrt(M * s * R)` with `R = 10000^2 * reserve_in`, at marginal output `1 / w^2` a pool takes `(w * g - R) / M`
+        static inline uint128 split_slope( const hop& pool )
+        {
+            return isqrt(mul_wide(static_cast<uint128>(split_fee_multiplier(pool)) * pool.reserve_out, static_cast<uint128>(pool.reserve_in) * 100000000));
+        }
+
+        // allocation of `pool` at integer water level `level_scaled = level * M_p` (`w = level * M_p / g_p`), `limit + 1` above `limit`
+        static inline uint128 split_allocation( const hop& pool, const uint128 slope, const uint128 level_scaled, const uint128 slope_p, const uint64_t limit )
+        {
+            const uint128 over = static_cast<uint128>(limit) + 1;
+            const uint256 x = mul_wide(level_scaled, slope);
+            if ( x.high >= slope_p ) return over;
+            const uint128 denominator = div_wide(x, slope_p);
+            const uint128 reserve_in = static_cast<uint128>(pool.reserve_in) * 100000000;
+            if ( denominator <= reserve_in ) return 0;
+            const uint128 amount = (denominator - reserve_in) / split_fee_multiplier(pool);
+            return amount > over ? over : amount;
+        }
+    }
+
+    /**
+     * ## STATIC `split_amount_in`
+     *
+     * Splits `amount_in` across pools of the same pair, maximizing the total output by equalizing marginal output
+     *
+     * Water-filling: at marginal output `1 / w^2` each pool takes `(w * g - R) / M` (`M` both fee multipliers out of 10000^2,
+     * `R = 10000^2 * r`, `g = sqrt(M * s * R)`), pools below their spot threshold take nothing. The water level is found in integers,
+     * by bisection on `level` with `w = level * M_p / g_p` for the pool `p` of steepest slope `g / M`: one level step moves every
+     * floored allocation by at most one unit, so the highest level whose allocations fit `amount_in` leaves fewer units than pools.
+     * A double-precision estimate only seeds the bracket.
+     * Those are handed out by a max-heap on marginal output, then at most one exchange per pool moves the input of one output step
+     * (a single unit unless flooring flattens the output) from the pool losing least to the pool with the highest marginal output
+     * while it raises the total. The fix-up is thus bounded by `2 * size` moves and matches the best integer split across pools
+     * without protocol fee in practice. `get_amount_out` flooring is not concave though, a wide flat stretch or the per-pool
+     * rounding of protocol fees can still hide a gain a few units away.
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_in` - total amount input
+     * - `{const hop*} pools` - pools of the same pair, in the same direction
+     * - `{size_t} size` - number of pools
+     * - `{uint64_t*} amounts` - (output) amount input per pool, sums to `amount_in`
+     * - `{size_t*} order` - scratch space for `size` pool indices
+     *
+     * ### returns
+     *
+     * - `{uint64_t}` - total amount output, checked against 64-bit overflow
+     *
+     * ### example
+     *
+     * ```c++
+     * // Inputs
+     * const uniswap::hop pools[] = {
+     *     { 1000000000, 4000000000, 30, 0 },
+     *     { 500000000, 2000000000, 20, 0 }
+     * };
+     *
+     * // Calculation
+     * uint64_t amounts[2];
+     * const uint64_t amount_out = uniswap::split_amount_in( 30000000, pools, amounts );
+     * // => 117339771 (amounts = { 19835852, 10164148 })
+     * ```
+     */
+    static inline uint64_t split_amount_in( const uint64_t amount_in, const hop* pools, const size_t size, uint64_t* amounts, size_t* order )
+    {
+        detail::check(amount_in > 0, "SX.Uniswap: INSUFFICIENT_INPUT_AMOUNT");
+
+        // non-empty pools, `p` of steepest slope `g / M`
+        size_t active = 0;
+        size_t p = size;
+        uint128 slope_p = 0;
+        for ( size_t i = 0; i < size; i++ ) {
+            amounts[i] = 0;
+            if ( pools[i].reserve_in == 0 || pools[i].reserve_out == 0 || pools[i].fee >= 10000 || pools[i].protocol_fee >= 10000 ) continue;
+            order[active++] = i;
+            const uint128 slope = detail::split_slope(pools[i]);
+            if ( p == size || slope * detail::split_fee_multiplier(pools[p]) > slope_p * detail::split_fee_multiplier(pools[i]) ) {
+                p = i;
+                slope_p = slope;
+            }
+        }
+        detail::check(active > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+
+        // highest integer level whose allocations fit, pool `p` takes `level - R_p / M_p` so `hi` overshoots `amount_in`
+        const uint64_t multiplier_p = detail::split_fee_multiplier(pools[p]);
+        const auto allocated = [&]( const uint128 level ) -> uint128 {
+            uint128 total = 0;
+            for ( size_t i = 0; i < active; i++ ) {
+                const hop& pool = pools[order[i]];
+                const uint128 slope = order[i] == p ? slope_p : detail::split_slope(pool);
+                total += detail::split_allocation(pool, slope, level * multiplier_p, slope_p, amount_in);
+            }
+            return total;
+        };
+        const uint128 top = static_cast<uint128>(pools[p].reserve_in) * 100000000 / multiplier_p + amount_in + 2;
+
+        // bracket seeded by the double water level: pools join by best spot price while `w = (amount_in + sum(R / M)) / sum(g / M)`
+        // stays above their threshold `R / g`, level `w * g_p / M_p`, galloping keeps the result independent of the seed
+        std::sort(order, order + active, [&]( const size_t a, const size_t b ) {
+            return detail::marginal_amount_out(pools[a], 0) > detail::marginal_amount_out(pools[b], 0);
+        });
+        double sum_g = 0;
+        double sum_r = 0;
+        double w = 0;
+        for ( size_t i = 0; i < active; i++ ) {
+            const hop& pool = pools[order[i]];
+            const double m = static_cast<double>(detail::split_fee_multiplier(pool));
+            const double g = std::sqrt(m * pool.reserve_out * 100000000.0 * pool.reserve_in);
+            const double r = 100000000.0 * pool.reserve_in;
+            if ( i > 0 && w <= r / g ) break;
+            sum_g += g / m;
+            sum_r += r / m;
+            w = (static_cast<double>(amount_in) + sum_r) / sum_g;
+        }
+        const double seed = w * detail::to_double(slope_p) / static_cast<double>(multiplier_p);
+        const uint128 guess = seed >= detail::to_double(top - 1) ? top - 1 : detail::from_double(seed);
+        uint128 lo = guess;
+        uint128 hi = guess + 1;
+        for ( uint128 step = 1; allocated(hi) <= amount_in; step <<= 1 ) {
+            lo = hi;
+            hi = top - hi > step ? hi + step : top;
+        }
+        for ( uint128 step = 1; lo > 0 && allocated(lo) > amount_in; step <<= 1 ) {
+            hi = lo;
+            lo = lo > step ? lo - step : uint128(0);
+        }
+        while ( hi - lo > 1 ) {
+            const uint128 mid = lo + (hi - lo) / 2;
+            if ( allocated(mid) <= amount_in ) lo = mid;
+            else hi = mid;
+        }
+        uint64_t remaining = amount_in;
+        for ( size_t i = 0; i < active; i++ ) {
+            const hop& pool = pools[order[i]];
+            const uint128 slope = order[i] == p ? slope_p : detail::split_slope(pool);
+            amounts[order[i]] = detail::lo(detail::split_allocation(pool, slope, lo * multiplier_p, slope_p, amount_in));
+            remaining -= amounts[order[i]];
+        }
+
+        // fewer units than pools remain, one per move to the highest marginal output
+        const auto lower = [&]( const size_t a, const size_t b ) {
+            return detail::marginal_amount_out(pools[a], amounts[a] + 0.5) < detail::marginal_amount_out(pools[b], amounts[b] + 0.5);
+        };
+        std::make_heap(order, order + active, lower);
+        for ( size_t move = 0; remaining > 0 && move < active; move++ ) {
+            const uint64_t step = 1 + (remaining - 1) / (active - move);
+            std::pop_heap(order, order + active, lower);
+            amounts[order[active - 1]] += step;
+            remaining -= step;
+            std::push_heap(order, order + active, lower);
+        }
+
+        // exchange, at most one move per pool: the pool with the highest marginal output takes the input of its next output step
+        // from the pool losing the least for it, while that raises the total
+        const auto output = [&]( const size_t index, const uint64_t amount ) -> uint64_t {
+            return amount ? detail::get_amount_out(amount, pools[index].reserve_in, pools[index].reserve_out, pools[index].fee, pools[index].protocol_fee) : 0;
+        };
+        for ( size_t move = 0; move < active; move++ ) {
+            size_t to = size;
+            uint64_t step = 0;
+            uint64_t gain = 0;
+            for ( size_t i = 0; i < active; i++ ) {
+                const size_t index = order[i];
+                const uint64_t amount_out = output(index, amounts[index]);
+                uint64_t amount = 0;
+                if ( !detail::get_cheapest_amount_in(amount_out + 1, pools + index, 1, amount) ) continue;
+                const uint64_t more = output(index, amount) - amount_out;
+                if ( to == size || static_cast<uint128>(more) * step > static_cast<uint128>(gain) * (amount - amounts[index]) ) {
+                    to = index;
+                    step = amount - amounts[index];
+                    gain = more;
+                }
+            }
+            if ( to == size ) break;
+
+            size_t from = size;
+            uint64_t loss = 0;
+            for ( size_t i = 0; i < active; i++ ) {
+                const size_t index = order[i];
+                if ( index == to || amounts[index] < step ) continue;
+                const uint64_t less = output(index, amounts[index]) - output(index, amounts[index] - step);
+                if ( from == size || less < loss ) {
+                    from = index;
+                    loss = less;
+                }
+            }
+            if ( from == size || gain <= loss ) break;
+            amounts[to] += step;
+            amounts[from] -= step;
+        }
+
+        // pools of one pair can jointly output more than 64 bits
+        uint128 amount_out = 0;
+        for ( size_t i = 0; i < active; i++ ) {
+            amount_out += output(order[i], amounts[order[i]]);
+        }
+        detail::check(detail::hi(amount_out) == 0, "SX.Uniswap: OVERFLOW");
+        return detail::lo(amount_out);
+    }
+
+    /**
+     * ## STATIC `split_amount_in<size>`
+     *
+     * `split_amount_in` for a pool count known at compile time, scratch space on the stack
+     */
+    template <size_t size>
+    static inline uint64_t split_amount_in( const uint64_t amount_in, const hop (&pools)[size], uint64_t (&amounts)[size] )
+    {
+        size_t order[size];
+        return split_amount_in(amount_in, pools, size, amounts, order);
+    }
+
+    /**
+     * ## CONSTANT `MINIMUM_LIQUIDITY`
+     *
+     * Liquidity locked forever by the first mint of a pair
+     */
+    static const uint64_t MINIMUM_LIQUIDITY = 1000;
+
+    /**
+     * ## STRUCT `pair_amounts`
+     *
+     * - `{uint64_t} amount_a` - amount A
+     * - `{uint64_t} amount_b` - amount B
+     */
+    struct pair_amounts {
+        uint64_t amount_a;
+        uint64_t amount_b;
+    };
+
+    /**
+     * ## STATIC `get_initial_liquidity`
+     *
+     * Given the first deposit of a pair, returns the liquidity minted to the provider, `sqrt(amount_a * amount_b) - MINIMUM_LIQUIDITY`
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_a` - amount A
+     * - `{uint64_t} amount_b` - amount B
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t liquidity = uniswap::get_initial_liquidity( 100000000, 400000000 );
+     * // => 199999000
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR uint64_t get_initial_liquidity( const uint64_t amount_a, const uint64_t amount_b )
+    {
+        const uint64_t liquidity = isqrt(static_cast<uint128>(amount_a) * amount_b);
+        detail::check(liquidity > MINIMUM_LIQUIDITY, "SX.Uniswap: INSUFFICIENT_LIQUIDITY_MINTED");
+        return liquidity - MINIMUM_LIQUIDITY;
+    }
+
+    namespace detail {
+        // unchecked `get_liquidity` for a non-empty pair, a side exceeding 64 bits cannot be the minimum, returns false when both do
+        static inline UNISWAP_CONSTEXPR bool get_liquidity( const uint64_t amount_a, const uint64_t amount_b, const uint64_t reserve_a, const uint64_t reserve_b, const uint64_t supply, uint64_t& liquidity )
+        {
+            uint64_t liquidity_a = 0;
+            uint64_t liquidity_b = 0;
+            const bool fits_a = try_mul_div(amount_a, supply, reserve_a, liquidity_a);
+            const bool fits_b = try_mul_div(amount_b, supply, reserve_b, liquidity_b);
+            liquidity = !fits_a ? liquidity_b : !fits_b ? liquidity_a : (liquidity_a < liquidity_b ? liquidity_a : liquidity_b);
+            return fits_a || fits_b;
+        }
+    }
+
+    /**
+     * ## STATIC `get_liquidity`
+     *
+     * Given a deposit, pair reserves and liquidity supply, returns the liquidity minted, `min(amount_a * supply / reserve_a, amount_b * supply / reserve_b)`
+     *
+     * Falls back to `get_initial_liquidity` when `supply` is 0
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_a` - amount A
+     * - `{uint64_t} amount_b` - amount B
+     * - `{uint64_t} reserve_a` - reserve A
+     * - `{uint64_t} reserve_b` - reserve B
+     * - `{uint64_t} supply` - liquidity supply
+     *
+     * ### example
+     *
+     * ```c++
+     * const uint64_t liquidity = uniswap::get_liquidity( 10000, 40000, 100000000, 400000000, 200000000 );
+     * // => 20000
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR uint64_t get_liquidity( const uint64_t amount_a, const uint64_t amount_b, const uint64_t reserve_a, const uint64_t reserve_b, const uint64_t supply )
+    {
+        if ( supply == 0 ) return get_initial_liquidity(amount_a, amount_b);
+        detail::check(reserve_a > 0 && reserve_b > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+
+        uint64_t liquidity = 0;
+        detail::check(detail::get_liquidity(amount_a, amount_b, reserve_a, reserve_b, supply, liquidity), "SX.Uniswap: OVERFLOW");
+        detail::check(liquidity > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY_MINTED");
+        return liquidity;
+    }
+
+    /**
+     * ## STATIC `get_burn_amounts`
+     *
+     * Given liquidity burned, pair reserves and liquidity supply, returns the amounts withdrawn, `liquidity * reserve / supply` each
+     *
+     * ### params
+     *
+     * - `{uint64_t} liquidity` - liquidity burned
+     * - `{uint64_t} reserve_a` - reserve A
+     * - `{uint64_t} reserve_b` - reserve B
+     * - `{uint64_t} supply` - liquidity supply
+     *
+     * ### example
+     *
+     * ```c++
+     * const uniswap::pair_amounts amounts = uniswap::get_burn_amounts( 20000, 100010000, 400040000, 200020000 );
+     * // => { 10000, 40000 }
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR pair_amounts get_burn_amounts( const uint64_t liquidity, const uint64_t reserve_a, const uint64_t reserve_b, const uint64_t supply )
+    {
+        detail::check(liquidity <= supply && supply > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+
+        // liquidity <= supply keeps both results within their reserves
+        const pair_amounts amounts = { detail::mul_div(liquidity, reserve_a, supply), detail::mul_div(liquidity, reserve_b, supply) };
+        detail::check(amounts.amount_a > 0 && amounts.amount_b > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY_BURNED");
+        return amounts;
+    }
+
+    /**
+     * ## STATIC `get_add_liquidity_amounts`
+     *
+     * Given desired deposit amounts and pair reserves, returns the amounts matching the pair ratio without exceeding either desired amount (`quote` based)
+     *
+     * Empty pairs take the desired amounts as is
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount_a_desired` - maximum amount A
+     * - `{uint64_t} amount_b_desired` - maximum amount B
+     * - `{uint64_t} reserve_a` - reserve A
+     * - `{uint64_t} reserve_b` - reserve B
+     *
+     * ### example
+     *
+     * ```c++
+     * const uniswap::pair_amounts amounts = uniswap::get_add_liquidity_amounts( 10000, 50000, 100000000, 400000000 );
+     * // => { 10000, 40000 }
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR pair_amounts get_add_liquidity_amounts( const uint64_t amount_a_desired, const uint64_t amount_b_desired, const uint64_t reserve_a, const uint64_t reserve_b )
+    {
+        if ( reserve_a == 0 && reserve_b == 0 ) return pair_amounts{ amount_a_desired, amount_b_desired };
+        detail::check(reserve_a > 0 && reserve_b > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+
+        detail::check(amount_a_desired > 0, "SX.Uniswap: INSUFFICIENT_AMOUNT");
+
+        // amount B at the pair ratio can exceed 64 bits when A is plentiful, B then bounds the deposit
+        const uint128 amount_b_optimal = static_cast<uint128>(amount_a_desired) * reserve_b / reserve_a;
+        if ( amount_b_optimal <= amount_b_desired ) return pair_amounts{ amount_a_desired, detail::lo(amount_b_optimal) };
+        return pair_amounts{ quote(amount_b_desired, reserve_b, reserve_a), amount_b_desired };
+    }
+
+    /**
+     * ## STRUCT `zap`
+     *
+     * - `{uint64_t} amount_in` - amount A swapped into B
+     * - `{uint64_t} amount_out` - amount B received, deposited with the remaining A
+     * - `{uint64_t} liquidity` - liquidity minted
+     */
+    struct zap {
+        uint64_t amount_in;
+        uint64_t amount_out;
+        uint64_t liquidity;
+    };
+
+    /**
+     * ## STATIC `get_zap`
+     *
+     * Given an amount of token A to deposit alone, returns the swap into B leaving the remainder at the pair ratio after the swap, and the liquidity minted
+     *
+     * With `m = 10000 - fee` and `n = 10000 - protocol_fee`, the swap amount `s` solves
+     * `m * n^2 * s^2 + 10000 * r_a * (10^8 + m * n) * s - 10^12 * r_a * amount = 0`, i.e. with `P = 10000 * (10^8 + m * n)`:
+     *
+     * `s = (sqrt((r_a * P)^2 + 4 * 10^12 * m * n^2 * r_a * amount) - r_a * P) / (2 * m * n^2)`
+     *
+     * Minting only moves in whole units of either token, so the result keeps the most liquidity among swaps of `s - 1`, `s` and `s + 1`
+     * and the cheapest swaps buying one unit less, the same and one unit more B than `s`.
+     *
+     * ### params
+     *
+     * - `{uint64_t} amount` - amount A deposited
+     * - `{uint64_t} reserve_a` - reserve A
+     * - `{uint64_t} reserve_b` - reserve B
+     * - `{uint64_t} supply` - liquidity supply
+     * - `{uint16_t} [fee=30]` - (optional) trade fee (pips 1/100 of 1%)
+     * - `{uint16_t} [protocol_fee=0]` - (optional) protocol fee (pips 1/100 of 1%) deducted from the swap input
+     *
+     * ### example
+     *
+     * ```c++
+     * const uniswap::zap zap = uniswap::get_zap( 1000000, 100000000, 400000000, 200000000 );
+     * // => { amount_in: 499505, amount_out: 1982154, liquidity: 996012 }
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR zap get_zap( const uint64_t amount, const uint64_t reserve_a, const uint64_t reserve_b, const uint64_t supply, const uint16_t fee = 30, const uint16_t protocol_fee = 0 )
+    {
+        detail::check(amount > 1, "SX.Uniswap: INSUFFICIENT_INPUT_AMOUNT");
+        detail::check(reserve_a > 0 && reserve_b > 0 && supply > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY");
+        detail::check(fee < 10000 && protocol_fee < 10000, "SX.Uniswap: INVALID_FEE");
+        detail::check(amount <= ~uint64_t(0) - reserve_a, "SX.Uniswap: OVERFLOW");
+
+        // closed form, operands stay within 225 bits
+        const uint64_t m = 10000 - fee;
+        const uint64_t n = 10000 - protocol_fee;
+        const uint128 q = static_cast<uint128>(m) * n * n;
+        const uint128 base = static_cast<uint128>(reserve_a) * (10000 * (100000000 + m * n));
+        const detail::uint256 discriminant = detail::add(detail::mul_wide(base, base), detail::mul_wide(static_cast<uint128>(reserve_a) * amount, q * 4000000000000));
+        const uint128 estimate = (detail::isqrt(discriminant) - base) / (2 * q);
+        const uint64_t swap = detail::hi(estimate) || detail::lo(estimate) >= amount ? amount - 1 : detail::lo(estimate);
+        const uint64_t target = detail::get_amount_out(swap, reserve_a, reserve_b, fee, protocol_fee);
+
+        uint64_t candidates[6] = { swap > 1 ? swap - 1 : 1, swap, swap + 1, 0, 0, 0 };
+        for ( size_t i = 0; i < 3; i++ ) {
+            // cheapest swap buying `target - 1 + i`, `get_amount_in` can overshoot by one unit
+            const uint64_t amount_out = target + i - 1;
+            uint64_t amount_in = 0;
+            if ( !amount_out || amount_out >= reserve_b || !detail::get_amount_in(amount_out, reserve_a, reserve_b, fee, protocol_fee, amount_in) ) continue;
+            if ( amount_in > 1 && detail::get_amount_out(amount_in - 1, reserve_a, reserve_b, fee, protocol_fee) >= amount_out ) amount_in--;
+            candidates[3 + i] = amount_in;
+        }
+
+        zap best = { 0, 0, 0 };
+        for ( const uint64_t amount_in : candidates ) {
+            if ( !amount_in || amount_in >= amount ) continue;
+            const uint64_t amount_out = detail::get_amount_out(amount_in, reserve_a, reserve_b, fee, protocol_fee);
+            const uint64_t pool_in = amount_in - detail::protocol_fee_amount(amount_in, protocol_fee);
+
+            uint64_t liquidity = 0;
+            if ( !amount_out || !detail::get_liquidity(amount - amount_in, amount_out, reserve_a + pool_in, reserve_b - amount_out, supply, liquidity) ) continue;
+            if ( liquidity > best.liquidity ) best = zap{ amount_in, amount_out, liquidity };
+        }
+        detail::check(best.liquidity > 0, "SX.Uniswap: INSUFFICIENT_LIQUIDITY_MINTED");
+        return best;
+    }
+
+    /**
+     * ## STATIC `verify_k`
+     *
+     * Returns whether a swap keeps the fee-adjusted constant product (Uniswap V2 `K` check), for replaying swaps
+     *
+     * `(balance0 * 10000 - amount0_in * fee) * (balance1 * 10000 - amount1_in * fee) >= reserve0 * reserve1 * 10000^2`
+     *
+     * Both sides reach ~2^156, bit lengths settle most swaps without multiplying, products that fit are compared in 128 bits
+     * and the rest in 256 bits.
+     *
+     * ### params
+     *
+     * - `{uint64_t} balance0` - balance 0 after the swap
+     * - `{uint64_t} balance1` - balance 1 after the swap
+     * - `{uint64_t} amount0_in` - amount 0 input
+     * - `{uint64_t} amount1_in` - amount 1 input
+     * - `{uint64_t} reserve0` - reserve 0 before the swap
+     * - `{uint64_t} reserve1` - reserve 1 before the swap
+     * - `{uint16_t} [fee=30]` - (optional) trade fee (pips 1/100 of 1%)
+     *
+     * ### example
+     *
+     * ```c++
+     * // 10000 in, 27328 out
+     * const bool valid = uniswap::verify_k( 45851941234, 125682006205, 10000, 0, 45851931234, 125682033533 );
+     * // => true
+     * ```
+     */
+    static inline UNISWAP_CONSTEXPR bool verify_k( const uint64_t balance0, const uint64_t balance1, const uint64_t amount0_in, const uint64_t amount1_in, const uint64_t reserve0, const uint64_t reserve1, const uint16_t fee = 30 )
+    {
+        const uint128 scaled0 = static_cast<uint128>(balance0) * 10000;
+        const uint128 scaled1 = static_cast<uint128>(balance1) * 10000;
+        const uint128 fee0 = static_cast<uint128>(amount0_in) * fee;
+        const uint128 fee1 = static_cast<uint128>(amount1_in) * fee;
+        if ( scaled0 < fee0 || scaled1 < fee1 ) return false;
+
+        const uint128 adjusted0 = scaled0 - fee0;
+        const uint128 adjusted1 = scaled1 - fee1;
+        const uint128 k = static_cast<uint128>(reserve0) * reserve1;
+        if ( k == 0 ) return true;
+        if ( adjusted0 == 0 || adjusted1 == 0 ) return false;
+
+        // `x * y` lies in `[2^(bits(x) + bits(y) - 2), 2^(bits(x) + bits(y)))`, 10000^2 has 27 bits
+        const int lhs = detail::bits(adjusted0) + detail::bits(adjusted1);
+        const int rhs = detail::bits(k) + 27;
+        if ( lhs - 2 >= rhs ) return true;
+        if ( lhs <= rhs - 2 ) return false;
+
+        if ( lhs <= 128 && rhs <= 128 ) return adjusted0 * adjusted1 >= k * 100000000;
+        return !detail::less(detail::mul_wide(adjusted0, adjusted1), detail::mul_wide(k, 100000000));
     }
 }
\ No newline at end of file
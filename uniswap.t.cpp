@@ -1,10 +1,25 @@
 #define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 
 #include <catch.hpp>
 #include <eosio/check.hpp>
 #include <uint128_t/uint128_t.cpp>
 
 #include "uniswap.hpp"
+#include "graph.hpp"
+
+// xorshift64 with a fixed seed, randomized tests are reproducible
+struct xorshift {
+    uint64_t state = 88172645463325252ULL;
+
+    uint64_t operator()()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
 
 TEST_CASE( "get_amount_out #1 (pass)" ) {
     // Inputs
@@ -85,6 +100,14 @@ TEST_CASE( "quote (pass)" ) {
     const uint64_t amount_b = uniswap::quote( amount_a, reserve_a, reserve_b );
 
     REQUIRE( amount_b == 40000 );
+
+    // product beyond 64 bits, quoted amount within: 2^40 * 2^40 / 2^30
+    REQUIRE( uniswap::quote( 1ULL << 40, 1ULL << 30, 1ULL << 40 ) == 1ULL << 50 );
+    REQUIRE( uniswap::quote( ~uint64_t(0), ~uint64_t(0), 123456789 ) == 123456789 );
+    REQUIRE( uniswap::try_quote( 1ULL << 40, 1ULL << 30, 1ULL << 40 ).amount == 1ULL << 50 );
+
+    // quoted amount beyond 64 bits
+    REQUIRE( uniswap::try_quote( 1ULL << 40, 1, 1ULL << 40 ).code == uniswap::status::overflow );
 }
 
 TEST_CASE( "get_amount_out Defibox #1 (pass)" ) {
@@ -149,3 +172,1448 @@ TEST_CASE( "get_amount_out Defibox RAMS #5 (pass)" ) {
 
     REQUIRE( amountOut == 24403  );
 }
+
+TEST_CASE( "uint128_t divmod (pass)" ) {
+    // xorshift64 sequence with mixed operand widths
+    xorshift next;
+
+    int mismatches = 0;
+    for ( int i = 0; i < 10000; i++ ) {
+        const uint128_t n = uint128_t( next() >> (next() % 64), next() );
+        const uint128_t d = (i % 2) ? uint128_t( next() >> (next() % 64) ) : uint128_t( next() >> (next() % 64), next() );
+        if ( !d ) continue;
+
+        const uint128_t q = n / d;
+        const uint128_t r = n % d;
+        if ( !(r < d) || q * d + r != n ) mismatches++;
+    }
+    REQUIRE( mismatches == 0 );
+
+    // Calculation
+    const uint128_t numerator = uint128_t( 99700000 ) * 3774590382732755;
+    const uint128_t denominator = uint128_t( 100669664 ) * 10000 + 99700000;
+
+    REQUIRE( numerator / denominator == 373786282495 );
+    REQUIRE( uint128_t( "0xffffffffffffffffffffffffffffffff" ) / uint128_t( 1, 0 ) == 0xffffffffffffffffULL );
+    REQUIRE( uint128_t( "0xffffffffffffffffffffffffffffffff" ) % uint128_t( 1, 0 ) == 0xffffffffffffffffULL );
+}
+
+TEST_CASE( "uint128 backend (pass)" ) {
+    // Inputs
+    const uint64_t amount_in_with_fee = 99700000;
+    const uint64_t reserve_out = 3774590382732755;
+
+    // Calculation
+    const uniswap::uint128 numerator = static_cast<uniswap::uint128>(amount_in_with_fee) * reserve_out;
+
+    REQUIRE( sizeof(uniswap::uint128) == 16 );
+    REQUIRE( static_cast<uint64_t>(numerator >> 64) == 20400 );
+    REQUIRE( static_cast<uint64_t>(numerator) == 13082054780820533600ULL );
+}
+
+TEST_CASE( "get_amount_out overflow #1 (pass)" ) {
+    // Inputs
+    const uint64_t amount_in = 18446744073709551615ULL;
+    const uint64_t reserve_in = 18446744073709551615ULL;
+    const uint64_t reserve_out = 18446744073709551615ULL;
+
+    // Calculation
+    const uint64_t amountOut = uniswap::get_amount_out( amount_in, reserve_in, reserve_out );
+
+    REQUIRE( amountOut == 9209516195036766630ULL );
+}
+
+TEST_CASE( "get_amount_out overflow #2 (pass)" ) {
+    // Inputs
+    const uint64_t amount_in = 12000000000000000000ULL;
+    const uint64_t reserve_in = 3000000000000000000ULL;
+    const uint64_t reserve_out = 17000000000000000000ULL;
+
+    // Calculation
+    const uint64_t amountOut = uniswap::get_amount_out( amount_in, reserve_in, reserve_out );
+
+    REQUIRE( amountOut == 13591820368885324779ULL );
+}
+
+TEST_CASE( "get_amount_out overflow #3 (pass)" ) {
+    // Inputs
+    const uint64_t amount_in = 4611686018427387903;
+    const uint64_t reserve_in = 1000;
+    const uint64_t reserve_out = 4611686018427387903;
+
+    // Calculation
+    const uint64_t amountOut = uniswap::get_amount_out( amount_in, reserve_in, reserve_out, 30, 10 );
+
+    REQUIRE( amountOut == 4611686018427386898ULL );
+}
+
+TEST_CASE( "get_amount_out_batch (pass)" ) {
+    // Inputs
+    const uint64_t amount_in[] = { 10000, 10000, 0, 3734534447974, 10000, 18446744073709551615ULL };
+    const uint64_t reserve_in[] = { 100000000, 100669664, 100000000, 33593153629677144, 0, 18446744073709551615ULL };
+    const uint64_t reserve_out[] = { 400000000, 3774590382732755, 400000000, 899196436, 400000000, 18446744073709551615ULL };
+    const uint16_t fee[] = { 30, 30, 30, 30, 30, 30 };
+
+    // Calculation
+    uint64_t amount_out[6];
+    uint8_t errors[6];
+    const size_t failed = uniswap::get_amount_out_batch( amount_in, reserve_in, reserve_out, fee, 6, amount_out, errors );
+
+    REQUIRE( failed == 2 );
+    REQUIRE( amount_out[0] == 39876 );
+    REQUIRE( amount_out[1] == 373786282495 );
+    REQUIRE( amount_out[2] == 0 );
+    REQUIRE( amount_out[3] == 99652 );
+    REQUIRE( amount_out[4] == 0 );
+    REQUIRE( amount_out[5] == 9209516195036766630ULL );
+    REQUIRE( errors[0] == 0 );
+    REQUIRE( errors[2] == 1 );
+    REQUIRE( errors[4] == 1 );
+}
+
+TEST_CASE( "prepared_pool get_amount_out (pass)" ) {
+    // Inputs
+    const uniswap::prepared_pool pools[] = {
+        uniswap::prepared_pool( 100000000, 400000000 ),
+        uniswap::prepared_pool( 100669664, 3774590382732755, 30, 0 ),
+        uniswap::prepared_pool( 47563210, 48270636583184845, 20, 10 ),
+        uniswap::prepared_pool( 65394, 93823580, 20, 10 ),
+        uniswap::prepared_pool( 3000000000000000000ULL, 17000000000000000000ULL ),
+        uniswap::prepared_pool( 18446744073709551615ULL, 18446744073709551615ULL, 30, 5 ),
+        uniswap::prepared_pool( 1000, 2000, 99, 0 ),
+        uniswap::prepared_pool( 65394, 93823580, 20, 12000 ),
+    };
+    xorshift next;
+
+    int mismatches = 0;
+    for ( const uniswap::prepared_pool& pool : pools ) {
+        for ( int i = 0; i < 200; i++ ) {
+            const uint64_t state = next();
+            const uint64_t amount_in = (state >> (i % 64)) | 1;
+
+            // Calculation
+            const uint64_t amountOut = pool.get_amount_out( amount_in );
+
+            if ( amountOut != uniswap::get_amount_out( amount_in, pool.reserve_in, pool.reserve_out, pool.fee, pool.protocol_fee ) ) mismatches++;
+        }
+    }
+    REQUIRE( mismatches == 0 );
+    REQUIRE( pools[0].get_amount_out( 10000 ) == 39876 );
+    REQUIRE( pools[1].get_amount_out( 10000 ) == 373786282495 );
+}
+
+TEST_CASE( "constexpr (pass)" ) {
+#if UNISWAP_HAS_CONSTEXPR
+    static_assert( uniswap::get_amount_out( 10000, 100000000, 400000000 ) == 39876, "get_amount_out #1" );
+    static_assert( uniswap::get_amount_out( 10000, 100669664, 3774590382732755, 30, 0 ) == 373786282495, "get_amount_out #2" );
+    static_assert( uniswap::get_amount_out( 3734534447974, 33593153629677144, 899196436 ) == 99652, "get_amount_out #3" );
+    static_assert( uniswap::get_amount_out( 10000, 45851931234, 125682033533 ) == 27328, "get_amount_out #4" );
+    static_assert( uniswap::get_amount_out( 18446744073709551615ULL, 18446744073709551615ULL, 18446744073709551615ULL ) == 9209516195036766630ULL, "get_amount_out overflow #1" );
+    static_assert( uniswap::get_amount_in( 39876, 100000000, 400000000 ) == 10000, "get_amount_in #1" );
+    static_assert( uniswap::get_amount_in( 373786282495, 100669664, 3774590382732755 ) == 10000, "get_amount_in #2" );
+    static_assert( uniswap::quote( 10000, 100000000, 400000000 ) == 40000, "quote" );
+    static_assert( uniswap::prepared_pool( 100000000, 400000000 ).get_amount_out( 10000 ) == 39876, "prepared_pool" );
+#endif
+
+    // Calculation
+    UNISWAP_CONSTEXPR uint64_t amountOut = uniswap::get_amount_out( 10000, 100000000, 400000000 );
+
+    REQUIRE( amountOut == 39876 );
+}
+
+TEST_CASE( "get_amount_out<fee, protocol_fee> (pass)" ) {
+    // Calculation
+    const uint64_t amountOut1 = uniswap::get_amount_out<30>( 10000, 100000000, 400000000 );
+    const uint64_t amountOut2 = uniswap::get_amount_out<30, 0>( 10000, 100669664, 3774590382732755 );
+    const uint64_t amountOut3 = uniswap::get_amount_out<20, 10>( 1000, 47563210, 48270636583184845 );
+    const uint64_t amountOut4 = uniswap::get_amount_out<20, 10>( 212, 4779316, 553900794 );
+    const uint64_t amountOut5 = uniswap::get_amount_out<30>( 18446744073709551615ULL, 18446744073709551615ULL, 18446744073709551615ULL );
+
+    REQUIRE( amountOut1 == 39876 );
+    REQUIRE( amountOut2 == 373786282495 );
+    REQUIRE( amountOut3 == 1011809599026 );
+    REQUIRE( amountOut4 == 24403 );
+    REQUIRE( amountOut5 == 9209516195036766630ULL );
+    REQUIRE( uniswap::get_amount_out<20, 10>( 1, 65394, 93823580 ) == uniswap::get_amount_out( 1, 65394, 93823580, 20, 10 ) );
+
+#if UNISWAP_HAS_CONSTEXPR
+    static_assert( uniswap::get_amount_out<30>( 10000, 45851931234, 125682033533 ) == 27328, "get_amount_out<30>" );
+    static_assert( uniswap::get_amount_out<20, 10>( 1047, 65394, 93823580 ) == 1474206, "get_amount_out<20, 10>" );
+#endif
+}
+
+TEST_CASE( "get_amounts_out #1 (pass)" ) {
+    // Inputs
+    const uint64_t amount_in = 10000;
+    const uniswap::hop path[] = {
+        { 100000000, 400000000, 30, 0 },
+        { 400000000, 100000000, 30, 0 }
+    };
+
+    // Calculation
+    uint64_t amounts[3];
+    const uint64_t amountOut = uniswap::get_amounts_out( amount_in, path, 2, amounts );
+
+    REQUIRE( amountOut == 9938 );
+    REQUIRE( amounts[0] == 10000 );
+    REQUIRE( amounts[1] == 39876 );
+    REQUIRE( amounts[2] == 9938 );
+}
+
+TEST_CASE( "get_amounts_out #2 (pass)" ) {
+    // Inputs
+    const uint64_t amount_in = 10000; // 1.0000 EOS
+    const uniswap::hop path[] = {
+        { 100669664, 3774590382732755, 30, 0 }, // EOS => PINK
+        { 33593153629677144, 899196436, 30, 0 }, // PINK => EOS
+        { 47563210, 48270636583184845, 20, 10 } // EOS => ?
+    };
+
+    // Calculation
+    uint64_t amounts[4];
+    const uint64_t amountOut = uniswap::get_amounts_out( amount_in, path, amounts );
+
+    REQUIRE( amountOut == 10091889492750 );
+    REQUIRE( amounts[1] == 373786282495 );
+    REQUIRE( amounts[2] == 9975 );
+    REQUIRE( uniswap::get_amounts_out( amount_in, path, 3, amounts ) == 10091889492750 );
+}
+
+TEST_CASE( "get_amounts_in #1 (pass)" ) {
+    // Inputs
+    const uint64_t amount_out = 9938;
+    const uniswap::hop path[] = {
+        { 100000000, 400000000, 30, 0 },
+        { 400000000, 100000000, 30, 0 }
+    };
+
+    // Calculation
+    uint64_t amounts[3];
+    const uint64_t amountIn = uniswap::get_amounts_in( amount_out, path, amounts );
+
+    REQUIRE( amountIn == 10000 );
+    REQUIRE( amounts[1] == 39876 );
+    REQUIRE( amounts[2] == 9938 );
+}
+
+TEST_CASE( "get_amounts_in #2 (pass)" ) {
+    // Inputs
+    const uniswap::hop path[] = {
+        { 100669664, 3774590382732755, 30, 0 }, // EOS => PINK
+        { 33593153629677144, 899196436, 25, 0 }, // PINK => EOS
+        { 65394, 93823580, 20, 0 } // EOS => RAMS
+    };
+    xorshift next;
+
+    for ( int i = 0; i < 1000; i++ ) {
+        const uint64_t state = next();
+        const uint64_t amount_out = state % 90000000 + 1;
+
+        // Calculation
+        uint64_t amounts_in[4];
+        uint64_t amounts_out[4];
+        const uint64_t amountIn = uniswap::get_amounts_in( amount_out, path, 3, amounts_in );
+
+        // forward chain meets the target
+        REQUIRE( uniswap::get_amounts_out( amountIn, path, 3, amounts_out ) >= amount_out );
+    }
+}
+
+TEST_CASE( "get_amount_in protocol_fee #1 (pass)" ) {
+    // Inputs
+    const uint64_t amount_out = 1011809599026;
+    const uint64_t reserve_in = 47563210;
+    const uint64_t reserve_out = 48270636583184845;
+
+    // Calculation
+    const uint64_t amountIn = uniswap::get_amount_in( amount_out, reserve_in, reserve_out, 20, 10 );
+
+    REQUIRE( amountIn == 1000 );
+    REQUIRE( uniswap::get_amount_in( 24403, 4779316, 553900794, 20, 10 ) == 212 );
+    REQUIRE( uniswap::get_amount_in( 1, 100, 1000, 20, 10 ) == 2 );
+}
+
+TEST_CASE( "get_amount_in protocol_fee #2 (pass)" ) {
+    xorshift next;
+
+    for ( int i = 0; i < 2000; i++ ) {
+        const uint64_t state = next();
+
+        // Inputs
+        const uint64_t reserve_in = (state >> (i % 40 + 2)) | 1;
+        const uint64_t reserve_out = (state >> 20) + 2;
+        const uint64_t amount_out = state % (reserve_out / 2 + 1) + 1;
+        const uint16_t fee = i % 100;
+        const uint16_t protocol_fee = (i * 7) % 500 + 1;
+
+        // Calculation
+        const uint64_t amountIn = uniswap::get_amount_in( amount_out, reserve_in, reserve_out, fee, protocol_fee );
+        const uint64_t net = uniswap::get_amount_in( amount_out, reserve_in, reserve_out, fee );
+
+        // smallest input covering the input without protocol fee
+        REQUIRE( amountIn - uniswap::detail::protocol_fee_amount( amountIn, protocol_fee ) >= net );
+        REQUIRE( amountIn - 1 - uniswap::detail::protocol_fee_amount( amountIn - 1, protocol_fee ) < net );
+        REQUIRE( uniswap::get_amount_out( amountIn, reserve_in, reserve_out, fee, protocol_fee ) >= amount_out );
+    }
+}
+
+TEST_CASE( "get_arbitrage_amount_in #1 (pass)" ) {
+    // Inputs
+    const uniswap::hop buy = { 1000000000, 2000000000, 30, 0 };
+    const uniswap::hop sell = { 1900000000, 1050000000, 30, 0 };
+
+    // Calculation
+    const uint64_t amountIn = uniswap::get_arbitrage_amount_in( buy, sell );
+    const uint64_t amountOut = uniswap::get_amount_out( uniswap::get_amount_out( amountIn, 1000000000, 2000000000 ), 1900000000, 1050000000 );
+
+    REQUIRE( amountIn == 23569923 );
+    REQUIRE( amountOut > amountIn );
+    REQUIRE( uniswap::get_arbitrage_amount_in( buy, { 2000000000, 1000000000, 30, 0 } ) == 0 );
+}
+
+// profit of swapping `amount_in` around a cyclic path, 0 when not profitable
+static uint64_t cycle_profit( const uniswap::hop* path, const size_t size, const uint64_t amount_in )
+{
+    const uint64_t amount_out = uniswap::detail::get_amounts_out( amount_in, path, size );
+    return amount_out > amount_in ? amount_out - amount_in : 0;
+}
+
+// best profit over `[from, to)` by scanning every amount
+static uint64_t cycle_profit_reference( const uniswap::hop* path, const size_t size, const uint64_t from, const uint64_t to )
+{
+    uint64_t best = 0;
+    for ( uint64_t amount_in = from; amount_in < to; amount_in++ ) best = std::max( best, cycle_profit( path, size, amount_in ) );
+    return best;
+}
+
+TEST_CASE( "get_arbitrage_amount_in #2 (pass)" ) {
+    xorshift next;
+
+    int misses = 0;
+    for ( int i = 0; i < 60; i++ ) {
+        // Inputs: small pools priced up to 1000x apart with protocol fees, scanned in full
+        const uint64_t reserve = next() % 20000 + 1000;
+        const uint64_t price = i % 3 ? 1 : next() % 1000 + 1;
+        const uniswap::hop buy = { reserve, reserve * price * (10000 + next() % 300) / 10000, static_cast<uint16_t>(next() % 50), static_cast<uint16_t>(next() % 50) };
+        const uniswap::hop sell = { buy.reserve_out * (9700 + next() % 300) / 10000, reserve * (9700 + next() % 600) / 10000, static_cast<uint16_t>(next() % 50), static_cast<uint16_t>(next() % 50) };
+        const uniswap::hop path[] = { buy, sell };
+
+        // Calculation
+        const uint64_t amountIn = uniswap::get_arbitrage_amount_in( buy, sell );
+        const uint64_t profit = amountIn ? cycle_profit( path, 2, amountIn ) : 0;
+        const uint64_t best = cycle_profit_reference( path, 2, 1, reserve );
+
+        // flat optimum plateaus leave at most one unit of profit
+        if ( profit > best || profit + 1 < best ) misses++;
+    }
+    REQUIRE( misses == 0 );
+}
+
+TEST_CASE( "get_arbitrage_amount_in large pools (pass)" ) {
+    xorshift next;
+
+    int misses = 0;
+    for ( int i = 0; i < 30; i++ ) {
+        // Inputs: fee-30 pools up to 10^12 with asymmetric prices, scanned around the result
+        const uint64_t reserve = next() % 1000000000000ULL + 1000000000;
+        const uint64_t price = i % 2 ? 1 : next() % 1000 + 1;
+        const uniswap::hop buy = { reserve, reserve / 1000 * price * (10000 + next() % 300) / 10, 30, 0 };
+        const uniswap::hop sell = { buy.reserve_out / 10000 * (9700 + next() % 300), reserve / 10000 * (9700 + next() % 600), 30, 0 };
+        const uniswap::hop path[] = { buy, sell };
+
+        // Calculation
+        const uint64_t amountIn = uniswap::get_arbitrage_amount_in( buy, sell );
+        if ( amountIn == 0 ) continue;
+        const uint64_t profit = cycle_profit( path, 2, amountIn );
+        const uint64_t best = cycle_profit_reference( path, 2, amountIn > 5000 ? amountIn - 5000 : 1, amountIn + 5000 );
+
+        if ( profit + 1 < best ) misses++;
+    }
+    REQUIRE( misses == 0 );
+}
+
+TEST_CASE( "get_arbitrage_amount_in #3 (pass)" ) {
+    // Inputs
+    const uniswap::hop buy = { 4611686018427387903, 4611686018427387903, 30, 0 };
+    const uniswap::hop sell = { 4611686018427387903, 5000000000000000000ULL, 30, 0 };
+
+    // Calculation
+    const uint64_t amountIn = uniswap::get_arbitrage_amount_in( buy, sell );
+    const uint64_t amountOut = uniswap::get_amount_out( uniswap::get_amount_out( amountIn, buy.reserve_in, buy.reserve_out ), sell.reserve_in, sell.reserve_out );
+
+    REQUIRE( amountOut > amountIn );
+    REQUIRE( amountOut - amountIn >= uniswap::get_amount_out( uniswap::get_amount_out( amountIn + 1000, buy.reserve_in, buy.reserve_out ), sell.reserve_in, sell.reserve_out ) - (amountIn + 1000) );
+}
+
+TEST_CASE( "compile_route #1 (pass)" ) {
+    // Inputs
+    const uniswap::hop path[] = {
+        { 100000000, 400000000, 30, 0 },
+        { 400000000, 100000000, 30, 0 }
+    };
+
+    // Calculation
+    const uniswap::route route = uniswap::compile_route( path, 2 );
+
+    REQUIRE( route.reserve_in == 50075112 );
+    REQUIRE( route.reserve_out == 49924888 );
+    REQUIRE( route.error == 8 );
+    REQUIRE( route.get_amount_out( 1000000 ) == 974604 );
+    REQUIRE( route.get_amount_out( 1000000, true ) == 974604 );
+}
+
+TEST_CASE( "compile_route #2 (pass)" ) {
+    xorshift next;
+
+    for ( int i = 0; i < 200; i++ ) {
+        // Inputs
+        uniswap::hop path[4];
+        const size_t size = next() % 4 + 1;
+        bool protocol_fee = false;
+        for ( size_t j = 0; j < size; j++ ) {
+            path[j] = { (next() >> (next() % 50)) | 1, (next() >> (next() % 50)) | 1, static_cast<uint16_t>(next() % 100), static_cast<uint16_t>(next() % 4 ? 0 : next() % 30) };
+            if ( j > 0 ) protocol_fee |= path[j].protocol_fee > 0;
+        }
+
+        // Calculation
+        const uniswap::route route = uniswap::compile_route( path, size );
+
+        for ( int j = 0; j < 20; j++ ) {
+            const uint64_t amount_in = (next() >> (next() % 64)) | 1;
+            const uint64_t virtual_out = route.get_amount_out( amount_in );
+            const uint64_t exact_out = route.get_amount_out( amount_in, true );
+
+            if ( !protocol_fee ) REQUIRE( virtual_out >= exact_out );
+            REQUIRE( (virtual_out > exact_out ? virtual_out - exact_out : exact_out - virtual_out) <= route.error );
+        }
+    }
+}
+
+TEST_CASE( "get_arbitrage_amount_in route (pass)" ) {
+    // Inputs
+    const uniswap::hop path[] = {
+        { 1000000000, 2000000000, 30, 0 },
+        { 1900000000, 1050000000, 30, 0 }
+    };
+
+    // Calculation
+    const uint64_t amountIn = uniswap::get_arbitrage_amount_in( uniswap::compile_route( path, 2 ) );
+
+    REQUIRE( amountIn == 23569923 );
+
+    const uniswap::hop balanced[] = {
+        { 1000000000, 2000000000, 30, 0 },
+        { 2000000000, 1000000000, 30, 0 }
+    };
+    REQUIRE( uniswap::get_arbitrage_amount_in( uniswap::compile_route( balanced, 2 ) ) == 0 );
+}
+
+TEST_CASE( "get_arbitrage_amount_in route #2 (pass)" ) {
+    xorshift next;
+
+    int misses = 0;
+    int profitable = 0;
+    for ( int i = 0; i < 60; i++ ) {
+        // Inputs: 2 to 4 hop cycles, token values 1x to 4x apart, each pool mispriced by -0.5% to +2.5%, with protocol fees
+        const size_t size = next() % 3 + 2;
+        uint64_t value[5] = { 1000, next() % 3000 + 1000, next() % 3000 + 1000, next() % 3000 + 1000, 0 };
+        value[size] = value[0];
+        uniswap::hop path[4];
+        const uint64_t start = next() % 150000 + 50000;
+        for ( size_t j = 0; j < size; j++ ) {
+            const uint64_t reserve_in = j == 0 ? start : (next() % 150000 + 50000) * 1000 / value[j];
+            const uint64_t reserve_out = reserve_in * value[j] / value[j + 1] * (9950 + next() % 300) / 10000;
+            path[j] = { reserve_in, reserve_out, static_cast<uint16_t>(next() % 50), static_cast<uint16_t>(next() % 3 ? 0 : next() % 30) };
+        }
+
+        // Calculation
+        const uint64_t amountIn = uniswap::get_arbitrage_amount_in( uniswap::compile_route( path, size ) );
+        const uint64_t profit = amountIn ? cycle_profit( path, size, amountIn ) : 0;
+        // the optimum stays below an eighth of the first reserve
+        const uint64_t best = cycle_profit_reference( path, size, 1, start / 8 );
+
+        // every intermediate rounding can hide a better input on the flat optimum, one unit per hop
+        if ( profit > best || profit + size < best ) misses++;
+        if ( best > 0 ) profitable++;
+    }
+    REQUIRE( misses == 0 );
+    REQUIRE( profitable >= 20 );
+}
+
+TEST_CASE( "graph #1 (pass)" ) {
+    // Inputs
+    const uint64_t EOS = 1, USDT = 2, BOX = 3;
+    uniswap::graph graph;
+    const size_t eos_usdt = graph.add_pool( EOS, USDT, 1000000000, 4000000000 );
+    graph.add_pool( USDT, BOX, 4000000000, 2000000000 );
+    graph.add_pool( EOS, BOX, 1000000000, 2000000000 );
+
+    REQUIRE( graph.count_cycles() == 1 );
+    REQUIRE( graph.count_cycles( 2 ) == 0 );
+    REQUIRE( graph.scan().empty() );
+
+    // Calculation
+    const std::vector<uniswap::graph::opportunity> opportunities = graph.update( eos_usdt, 1000000000, 4400000000 );
+
+    REQUIRE( opportunities.size() == 1 );
+    REQUIRE( opportunities[0].token == EOS );
+    REQUIRE( opportunities[0].legs.size() == 3 );       // EOS -> USDT -> BOX -> EOS
+    REQUIRE( opportunities[0].legs[0].pool == eos_usdt );
+    REQUIRE( !opportunities[0].legs[0].reverse );
+    REQUIRE( graph.scan( 2 ).empty() );
+
+    const std::vector<uniswap::hop> path = graph.get_path( opportunities[0].legs );
+    uint64_t amounts[4];
+    REQUIRE( uniswap::get_amounts_out( opportunities[0].amount_in, path.data(), path.size(), amounts ) == opportunities[0].amount_out );
+    REQUIRE( opportunities[0].amount_out > opportunities[0].amount_in );
+}
+
+TEST_CASE( "graph #2 (pass)" ) {
+    xorshift next;
+
+    // Inputs: pools priced within 1% of a reference price per token
+    const size_t tokens = 12;
+    uint64_t price[tokens];
+    for ( size_t i = 0; i < tokens; i++ ) price[i] = next() % 1000000 + 1000;
+
+    uniswap::graph graph;
+    std::vector<std::pair<uint64_t, uint64_t>> pairs;
+    for ( int i = 0; i < 40; i++ ) {
+        const uint64_t token0 = next() % tokens;
+        const uint64_t token1 = (token0 + 1 + next() % (tokens - 1)) % tokens;
+        const uint64_t reserve0 = next() % 1000000000 + 1000000;
+        const uint64_t reserve1 = reserve0 * price[token0] / price[token1] * (9900 + next() % 200) / 10000 + 1;
+        graph.add_pool( token0, token1, reserve0, reserve1 );
+        pairs.emplace_back( token0, token1 );
+    }
+
+    // every simple cycle of 2 or 3 pools is enumerated once
+    size_t expected = 0;
+    for ( size_t a = 0; a < pairs.size(); a++ ) {
+        for ( size_t b = a + 1; b < pairs.size(); b++ ) {
+            const bool same = (pairs[a].first == pairs[b].first && pairs[a].second == pairs[b].second) || (pairs[a].first == pairs[b].second && pairs[a].second == pairs[b].first);
+            if ( same ) expected++;
+            for ( size_t c = b + 1; c < pairs.size(); c++ ) {
+                std::map<uint64_t, int> degree;
+                for ( const size_t i : { a, b, c } ) {
+                    degree[pairs[i].first]++;
+                    degree[pairs[i].second]++;
+                }
+                bool triangle = degree.size() == 3;
+                for ( const auto& d : degree ) triangle &= d.second == 2;
+                if ( triangle ) expected++;
+            }
+        }
+    }
+    REQUIRE( graph.count_cycles() == expected );
+
+    // incremental updates report exactly the profitable cycles through the pool
+    for ( int i = 0; i < 40; i++ ) {
+        const size_t index = next() % graph.pools().size();
+        const uniswap::graph::pool& pool = graph.pools()[index];
+        const std::vector<uniswap::graph::opportunity> found = graph.update( index, pool.reserve0, pool.reserve1 * (9500 + next() % 1000) / 10000 + 1 );
+
+        size_t expected_found = 0;
+        for ( const uniswap::graph::opportunity& opportunity : graph.scan() ) {
+            for ( const uniswap::graph::leg& leg : opportunity.legs ) expected_found += leg.pool == index;
+        }
+        REQUIRE( found.size() == expected_found );
+
+        for ( const uniswap::graph::opportunity& opportunity : found ) {
+            const std::vector<uniswap::hop> path = graph.get_path( opportunity.legs );
+            uint64_t amounts[4];
+            REQUIRE( uniswap::get_amounts_out( opportunity.amount_in, path.data(), path.size(), amounts ) == opportunity.amount_out );
+            REQUIRE( opportunity.amount_out > opportunity.amount_in );
+        }
+    }
+}
+
+TEST_CASE( "graph get_best_path #1 (pass)" ) {
+    // Inputs
+    const uint64_t EOS = 1, USDT = 2, BOX = 3;
+    uniswap::graph graph;
+    graph.add_pool( EOS, USDT, 1000000000, 4000000000 );
+    graph.add_pool( USDT, BOX, 4000000000, 2000000000 );
+    graph.add_pool( EOS, BOX, 1000000000, 1800000000 );
+
+    // Calculation
+    const uniswap::graph::best_path best = graph.get_best_path( EOS, BOX, 10000 );
+
+    REQUIRE( best.legs.size() == 2 );
+    REQUIRE( best.amount_out == 19879 );
+    REQUIRE( graph.get_best_path( EOS, BOX, 10000, 1 ).amount_out == 17945 );
+    REQUIRE( graph.get_best_path( EOS, 4, 10000 ).legs.empty() );
+}
+
+TEST_CASE( "graph get_best_path #2 (pass)" ) {
+    xorshift next;
+
+    // Inputs
+    const size_t tokens = 10;
+    uint64_t price[tokens];
+    for ( size_t i = 0; i < tokens; i++ ) price[i] = next() % 1000000 + 1000;
+
+    uniswap::graph graph;
+    for ( int i = 0; i < 40; i++ ) {
+        const uint64_t token0 = next() % tokens;
+        const uint64_t token1 = (token0 + 1 + next() % (tokens - 1)) % tokens;
+        const uint64_t reserve0 = next() % 1000000000 + 1000;
+        const uint64_t reserve1 = reserve0 * price[token0] / price[token1] * (9000 + next() % 2000) / 10000 + 1;
+        graph.add_pool( token0, token1, reserve0, reserve1, static_cast<uint16_t>(next() % 50) );
+    }
+
+    // brute force every simple path of up to `hops` pools
+    const std::vector<uniswap::graph::pool>& pools = graph.pools();
+    std::function<uint64_t(uint64_t, uint64_t, uint64_t, size_t, std::vector<uint64_t>&)> brute_force = [&]( const uint64_t token, const uint64_t token_out, const uint64_t amount, const size_t hops, std::vector<uint64_t>& visited ) -> uint64_t {
+        uint64_t best = 0;
+        for ( const uniswap::graph::pool& pool : pools ) {
+            if ( pool.token0 != token && pool.token1 != token ) continue;
+            const bool reverse = pool.token1 == token;
+            const uint64_t next = reverse ? pool.token0 : pool.token1;
+            if ( std::find( visited.begin(), visited.end(), next ) != visited.end() ) continue;
+            const uint64_t amount_out = uniswap::get_amount_out( amount, reverse ? pool.reserve1 : pool.reserve0, reverse ? pool.reserve0 : pool.reserve1, pool.fee );
+            if ( amount_out == 0 ) continue;
+            if ( next == token_out ) best = std::max( best, amount_out );
+            else if ( hops > 1 ) {
+                visited.push_back( next );
+                best = std::max( best, brute_force( next, token_out, amount_out, hops - 1, visited ) );
+                visited.pop_back();
+            }
+        }
+        return best;
+    };
+
+    for ( int i = 0; i < 100; i++ ) {
+        const uint64_t token_in = next() % tokens;
+        const uint64_t token_out = (token_in + 1 + next() % (tokens - 1)) % tokens;
+        const uint64_t amount_in = (next() >> (next() % 40)) % 1000000000000 + 1;
+        const size_t max_hops = i % 4 + 1;
+
+        // Calculation
+        const uniswap::graph::best_path best = graph.get_best_path( token_in, token_out, amount_in, max_hops );
+
+        std::vector<uint64_t> visited = { token_in };
+        REQUIRE( best.amount_out == brute_force( token_in, token_out, amount_in, max_hops, visited ) );
+        if ( best.amount_out ) {
+            const std::vector<uniswap::hop> path = graph.get_path( best.legs );
+            uint64_t amounts[5];
+            REQUIRE( uniswap::get_amounts_out( amount_in, path.data(), path.size(), amounts ) == best.amount_out );
+        }
+    }
+}
+
+TEST_CASE( "split_amount_in #1 (pass)" ) {
+    // Inputs
+    const uniswap::hop pools[] = {
+        { 1000000000, 4000000000, 30, 0 },
+        { 500000000, 2000000000, 20, 0 },
+        { 0, 2000000000, 30, 0 }
+    };
+
+    // Calculation
+    uint64_t amounts[3];
+    const uint64_t amountOut = uniswap::split_amount_in( 30000000, pools, amounts );
+
+    REQUIRE( amountOut == 117339771 );
+    REQUIRE( amounts[0] == 19835852 );
+    REQUIRE( amounts[1] == 10164148 );
+    REQUIRE( amounts[2] == 0 );
+    REQUIRE( amountOut > uniswap::get_amount_out( 30000000, pools[0].reserve_in, pools[0].reserve_out, pools[0].fee ) );
+}
+
+TEST_CASE( "split_amount_in #2 (pass)" ) {
+    xorshift next;
+
+    for ( int i = 0; i < 50; i++ ) {
+        // Inputs
+        const uniswap::hop pools[] = {
+            { next() % 100000 + 100, next() % 100000 + 100, static_cast<uint16_t>(next() % 60), 0 },
+            { next() % 100000 + 100, next() % 100000 + 100, static_cast<uint16_t>(next() % 60), 0 }
+        };
+        const uint64_t amount_in = next() % 20000 + 1;
+
+        // Calculation
+        uint64_t amounts[2];
+        const uint64_t amountOut = uniswap::split_amount_in( amount_in, pools, amounts );
+
+        // scan every split, flooring leaves at most one unit
+        uint64_t best = 0;
+        for ( uint64_t amount = 0; amount <= amount_in; amount++ ) {
+            const uint64_t out0 = amount ? uniswap::get_amount_out( amount, pools[0].reserve_in, pools[0].reserve_out, pools[0].fee ) : 0;
+            const uint64_t out1 = amount_in - amount ? uniswap::get_amount_out( amount_in - amount, pools[1].reserve_in, pools[1].reserve_out, pools[1].fee ) : 0;
+            best = std::max( best, out0 + out1 );
+        }
+        REQUIRE( amounts[0] + amounts[1] == amount_in );
+        REQUIRE( amountOut + 1 >= best );
+        REQUIRE( amountOut <= best );
+    }
+}
+
+TEST_CASE( "split_amount_in #3 (pass)" ) {
+    xorshift next;
+    const uint64_t ratios[] = { 1, 10, 100, 1000 };
+
+    // 3 and 4 pools of mixed depth and price, every split scanned
+    size_t misses = 0;
+    for ( int i = 0; i < 60; i++ ) {
+        // Inputs
+        const size_t size = i % 3 ? 3 : 4;
+        uniswap::hop pools[4];
+        for ( size_t j = 0; j < size; j++ ) {
+            const uint64_t reserve_in = next() % 1000000 + 10000;
+            const uint64_t reserve_out = (next() % 1000000 + 10000) * ratios[next() % 4];
+            pools[j] = { reserve_in, reserve_out, static_cast<uint16_t>(next() % 60), 0 };
+        }
+        const uint64_t amount_in = size == 3 ? next() % 1000 + 1 : next() % 200 + 1;
+
+        // Calculation
+        uint64_t amounts[4];
+        size_t order[4];
+        const uint64_t amountOut = uniswap::split_amount_in( amount_in, pools, size, amounts, order );
+
+        const auto out = [&]( const size_t j, const uint64_t amount ) -> uint64_t {
+            return amount ? uniswap::get_amount_out( amount, pools[j].reserve_in, pools[j].reserve_out, pools[j].fee ) : 0;
+        };
+        uint64_t best = 0;
+        for ( uint64_t a = 0; a <= amount_in; a++ ) {
+            for ( uint64_t b = 0; a + b <= amount_in; b++ ) {
+                if ( size == 3 ) best = std::max( best, out(0, a) + out(1, b) + out(2, amount_in - a - b) );
+                else for ( uint64_t c = 0; a + b + c <= amount_in; c++ ) best = std::max( best, out(0, a) + out(1, b) + out(2, c) + out(3, amount_in - a - b - c) );
+            }
+        }
+        uint64_t total = 0;
+        for ( size_t j = 0; j < size; j++ ) total += amounts[j];
+        if ( total != amount_in || amountOut != best ) misses++;
+    }
+    REQUIRE( misses == 0 );
+}
+
+TEST_CASE( "split_amount_in #4 (pass)" ) {
+    xorshift next;
+
+    // small pools where flooring is coarse, half of them charging a protocol fee, every split scanned
+    int mismatches = 0;
+    for ( int i = 0; i < 400; i++ ) {
+        // Inputs
+        const size_t size = 2 + i % 2;
+        const bool protocol_fee = i % 4 < 2;
+        uniswap::hop pools[3];
+        for ( size_t j = 0; j < size; j++ ) {
+            pools[j] = { next() % 5000 + 10, next() % 5000 + 10, static_cast<uint16_t>(next() % 100), static_cast<uint16_t>(protocol_fee ? next() % 100 : 0) };
+        }
+        const uint64_t amount_in = next() % 300 + 1;
+
+        // Calculation
+        uint64_t amounts[3];
+        size_t order[3];
+        const uint64_t amountOut = uniswap::split_amount_in( amount_in, pools, size, amounts, order );
+
+        const auto out = [&]( const size_t j, const uint64_t amount ) -> uint64_t {
+            return amount ? uniswap::get_amount_out( amount, pools[j].reserve_in, pools[j].reserve_out, pools[j].fee, pools[j].protocol_fee ) : 0;
+        };
+        uint64_t best = 0;
+        uint64_t total = 0;
+        for ( uint64_t a = 0; a <= amount_in; a++ ) {
+            if ( size == 2 ) best = std::max( best, out(0, a) + out(1, amount_in - a) );
+            else for ( uint64_t b = 0; a + b <= amount_in; b++ ) best = std::max( best, out(0, a) + out(1, b) + out(2, amount_in - a - b) );
+        }
+        for ( size_t j = 0; j < size; j++ ) total += amounts[j];
+
+        // never above the best split, within one unit of it unless protocol fee rounding breaks concavity
+        if ( total != amount_in || amountOut > best ) mismatches++;
+        if ( !protocol_fee && amountOut + 1 < best ) mismatches++;
+    }
+    REQUIRE( mismatches == 0 );
+}
+
+// bit-by-bit reference square root, one result bit per iteration
+static uniswap::uint128 isqrt_reference( const uniswap::detail::uint256& x )
+{
+    using namespace uniswap::detail;
+    if ( bits(x) == 0 ) return 0;
+    const int top = (bits(x) - 1) & ~1;
+    uint256 remainder = x;
+    uint256 root = { 0, 0 };
+    uint256 bit = top >= 128 ? uint256{ static_cast<uniswap::uint128>(1) << (top - 128), 0 } : uint256{ 0, static_cast<uniswap::uint128>(1) << top };
+    while ( bit.high != 0 || bit.low != 0 ) {
+        const uint256 trial = add(root, bit);
+        if ( !less(remainder, trial) ) {
+            remainder = sub(remainder, trial);
+            root = add(shr(root, 1), bit);
+        } else {
+            root = shr(root, 1);
+        }
+        bit = shr(bit, 2);
+    }
+    return root.low;
+}
+
+TEST_CASE( "isqrt #1 (pass)" ) {
+    using uniswap::uint128;
+    using uniswap::detail::uint256;
+    const uint128 max = ~uint128(0);
+
+    REQUIRE( uniswap::isqrt( 0 ) == 0 );
+    REQUIRE( uniswap::isqrt( 3 ) == 1 );
+    REQUIRE( uniswap::isqrt( 4 ) == 2 );
+    REQUIRE( uniswap::isqrt( static_cast<uint128>(45851931234) * 125682033533 ) == 75912870838 );
+    REQUIRE( uniswap::isqrt( max ) == ~uint64_t(0) );
+    REQUIRE( uniswap::detail::isqrt( uint256{ max, max } ) == max );
+    REQUIRE( uniswap::detail::isqrt( uint256{ max - 1, 0 } ) == max - 1 );
+    REQUIRE( uniswap::detail::isqrt( uint256{ 1, 0 } ) == static_cast<uint128>(1) << 64 );
+}
+
+TEST_CASE( "isqrt #2 (pass)" ) {
+    using uniswap::uint128;
+    using uniswap::detail::uint256;
+    xorshift next;
+
+    int mismatches = 0;
+    for ( int i = 0; i < 2000; i++ ) {
+        // perfect squares and their neighbours at every magnitude
+        const uint128 root = uniswap::detail::make_uint128( next() >> (next() % 64), next() );
+        const uint256 square = uniswap::detail::mul_wide( root, root );
+        const uint256 one = { 0, 1 };
+        if ( uniswap::detail::isqrt( square ) != root ) mismatches++;
+        if ( uniswap::detail::isqrt( uniswap::detail::add( square, one ) ) != root ) mismatches++;
+        if ( root != 0 && uniswap::detail::isqrt( uniswap::detail::sub( square, one ) ) != root - 1 ) mismatches++;
+
+        const uint256 x = uniswap::detail::shr( uint256{ uniswap::detail::make_uint128( next(), next() ), uniswap::detail::make_uint128( next(), next() ) }, next() % 128 );
+        if ( uniswap::detail::isqrt( x ) != isqrt_reference( x ) ) mismatches++;
+        if ( uniswap::isqrt( x.low ) != uniswap::detail::lo( isqrt_reference( uint256{ 0, x.low } ) ) ) mismatches++;
+    }
+    REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE( "isqrt benchmark", "[.benchmark]" ) {
+    const uniswap::detail::uint256 x = { uniswap::detail::make_uint128( 0x0123456789abcdefULL, 0xfedcba9876543210ULL ), uniswap::detail::make_uint128( 0x0f1e2d3c4b5a6978ULL, 0x8796a5b4c3d2e1f0ULL ) };
+
+    BENCHMARK( "isqrt 256-bit" ) { return uniswap::detail::isqrt( x ); };
+    BENCHMARK( "isqrt 256-bit reference" ) { return isqrt_reference( x ); };
+    BENCHMARK( "isqrt 128-bit" ) { return uniswap::isqrt( x.high ); };
+    BENCHMARK( "isqrt 128-bit reference" ) { return isqrt_reference( uniswap::detail::uint256{ 0, x.high } ); };
+}
+
+TEST_CASE( "get_amount_in_to_price #1 (pass)" ) {
+    // Inputs
+    const uint64_t reserve_in = 100000000;
+    const uint64_t reserve_out = 400000000;
+
+    // Calculation
+    const uint64_t amountIn = uniswap::get_amount_in_to_price( reserve_in, reserve_out, 39, 10 );
+    const uint64_t amountOut = uniswap::get_amount_out( amountIn, reserve_in, reserve_out );
+    const uint64_t amountOutLess = uniswap::get_amount_out( amountIn - 1, reserve_in, reserve_out );
+
+    REQUIRE( amountIn == 1275851 );
+    REQUIRE( (reserve_out - amountOut) * 10 <= (reserve_in + amountIn) * 39 );
+    REQUIRE( (reserve_out - amountOutLess) * 10 > (reserve_in + amountIn - 1) * 39 );
+    REQUIRE( uniswap::get_amount_in_to_price( reserve_in, reserve_out, 4, 1 ) == 0 );
+}
+
+TEST_CASE( "get_amount_in_to_price #2 (pass)" ) {
+    xorshift next;
+
+    // small pools: scan every amount
+    for ( int i = 0; i < 200; i++ ) {
+        const uint64_t reserve_in = next() % 5000 + 1;
+        const uint64_t reserve_out = next() % 5000 + 1;
+        const uint64_t numerator = next() % 100 + 1;
+        const uint64_t denominator = next() % 100 + 1;
+        const uint16_t fee = next() % 100;
+        const uint16_t protocol_fee = next() % 3 ? 0 : next() % 50;
+
+        uint64_t expected = 0;
+        while ( !uniswap::detail::reaches_price( expected, reserve_in, reserve_out, numerator, denominator, fee, protocol_fee ) ) expected++;
+        REQUIRE( uniswap::get_amount_in_to_price( reserve_in, reserve_out, numerator, denominator, fee, protocol_fee ) == expected );
+    }
+
+    // any magnitude: minimal amount reaching the target
+    for ( int i = 0; i < 2000; i++ ) {
+        const uint64_t reserve_in = (next() >> (next() % 60)) | 1;
+        const uint64_t reserve_out = (next() >> (next() % 60)) | 1;
+        const uint64_t numerator = (next() >> (next() % 64)) | 1;
+        const uint64_t denominator = (next() >> (next() % 64)) | 1;
+        const uint16_t fee = next() % 100;
+        const uint16_t protocol_fee = next() % 3 ? 0 : next() % 50;
+        if ( !uniswap::detail::reaches_price( ~uint64_t(0), reserve_in, reserve_out, numerator, denominator, fee, protocol_fee ) ) continue;
+
+        const uint64_t amountIn = uniswap::get_amount_in_to_price( reserve_in, reserve_out, numerator, denominator, fee, protocol_fee );
+        REQUIRE( uniswap::detail::reaches_price( amountIn, reserve_in, reserve_out, numerator, denominator, fee, protocol_fee ) );
+        if ( amountIn > 0 ) REQUIRE( !uniswap::detail::reaches_price( amountIn - 1, reserve_in, reserve_out, numerator, denominator, fee, protocol_fee ) );
+    }
+}
+
+TEST_CASE( "liquidity #1 (pass)" ) {
+    // Inputs
+    const uint64_t reserve_a = 100000000;
+    const uint64_t reserve_b = 400000000;
+
+    // Calculation
+    const uint64_t initial = uniswap::get_initial_liquidity( reserve_a, reserve_b );
+    const uint64_t supply = initial + uniswap::MINIMUM_LIQUIDITY;
+    const uniswap::pair_amounts deposit = uniswap::get_add_liquidity_amounts( 10000, 50000, reserve_a, reserve_b );
+    const uint64_t liquidity = uniswap::get_liquidity( deposit.amount_a, deposit.amount_b, reserve_a, reserve_b, supply );
+    const uniswap::pair_amounts withdrawn = uniswap::get_burn_amounts( liquidity, reserve_a + deposit.amount_a, reserve_b + deposit.amount_b, supply + liquidity );
+
+    REQUIRE( initial == 199999000 );
+    REQUIRE( uniswap::get_liquidity( reserve_a, reserve_b, 0, 0, 0 ) == initial );
+    REQUIRE( deposit.amount_a == 10000 );
+    REQUIRE( deposit.amount_b == 40000 );
+    REQUIRE( liquidity == 20000 );
+    REQUIRE( withdrawn.amount_a == 10000 );
+    REQUIRE( withdrawn.amount_b == 40000 );
+
+    const uniswap::pair_amounts limited = uniswap::get_add_liquidity_amounts( 50000, 40000, reserve_a, reserve_b );
+    REQUIRE( limited.amount_a == 10000 );
+    REQUIRE( limited.amount_b == 40000 );
+}
+
+TEST_CASE( "liquidity #2 (pass)" ) {
+    xorshift next;
+
+    for ( int i = 0; i < 1000; i++ ) {
+        // Inputs: wide reserves, the mint ratio never exceeds 64 bits in the intermediate products
+        const uint64_t reserve_a = (next() >> (next() % 56)) | 1024;
+        const uint64_t reserve_b = (next() >> (next() % 56)) | 1024;
+        const uint64_t supply = (next() >> (next() % 56)) | 1024;
+        const uint64_t amount_a_desired = (next() >> (next() % 64)) | 1;
+        const uint64_t amount_b_desired = (next() >> (next() % 64)) | 1;
+
+        // Calculation
+        const uniswap::pair_amounts deposit = uniswap::get_add_liquidity_amounts( amount_a_desired, amount_b_desired, reserve_a, reserve_b );
+        REQUIRE( deposit.amount_a <= amount_a_desired );
+        REQUIRE( deposit.amount_b <= amount_b_desired );
+
+        uint64_t liquidity_a = 0;
+        uint64_t liquidity_b = 0;
+        const bool fits_a = uniswap::detail::try_mul_div( deposit.amount_a, supply, reserve_a, liquidity_a );
+        const bool fits_b = uniswap::detail::try_mul_div( deposit.amount_b, supply, reserve_b, liquidity_b );
+        if ( !(fits_a || fits_b) || (fits_a ? liquidity_a : ~uint64_t(0)) == 0 || (fits_b ? liquidity_b : ~uint64_t(0)) == 0 ) continue;
+
+        // burning freshly minted liquidity never returns more than deposited
+        const uint64_t liquidity = uniswap::get_liquidity( deposit.amount_a, deposit.amount_b, reserve_a, reserve_b, supply );
+        if ( liquidity > ~uint64_t(0) - supply || reserve_a > ~uint64_t(0) - deposit.amount_a || reserve_b > ~uint64_t(0) - deposit.amount_b ) continue;
+        const uint64_t amount_a = uniswap::detail::mul_div( liquidity, reserve_a + deposit.amount_a, supply + liquidity );
+        const uint64_t amount_b = uniswap::detail::mul_div( liquidity, reserve_b + deposit.amount_b, supply + liquidity );
+        REQUIRE( amount_a <= deposit.amount_a );
+        REQUIRE( amount_b <= deposit.amount_b );
+    }
+}
+
+TEST_CASE( "get_zap #1 (pass)" ) {
+    // Inputs
+    const uint64_t amount = 1000000;
+    const uint64_t reserve_a = 100000000;
+    const uint64_t reserve_b = 400000000;
+    const uint64_t supply = 200000000;
+
+    // Calculation
+    const uniswap::zap zap = uniswap::get_zap( amount, reserve_a, reserve_b, supply );
+
+    // Asserts
+    REQUIRE( zap.amount_in == 499505 );
+    REQUIRE( zap.amount_out == 1982154 );
+    REQUIRE( zap.liquidity == 996012 );
+    REQUIRE( zap.amount_out == uniswap::get_amount_out( zap.amount_in, reserve_a, reserve_b ) );
+    REQUIRE( zap.liquidity == uniswap::get_liquidity( amount - zap.amount_in, zap.amount_out, reserve_a + zap.amount_in, reserve_b - zap.amount_out, supply ) );
+}
+
+TEST_CASE( "get_zap #2 (pass)" ) {
+    xorshift next;
+
+    for ( int i = 0; i < 200; i++ ) {
+        // Inputs: small pools, every swap amount can be minted
+        const uint64_t reserve_a = next() % 100000 + 1000;
+        const uint64_t reserve_b = next() % 100000 + 1000;
+        const uint64_t supply = next() % 100000 + 1000;
+        const uint64_t amount = next() % 5000 + 2;
+        const uint16_t fee = next() % 100;
+        const uint16_t protocol_fee = next() % 3 ? 0 : next() % 50;
+
+        // Brute force over every swap amount
+        uint64_t best = 0;
+        for ( uint64_t amount_in = 1; amount_in < amount; amount_in++ ) {
+            const uint64_t amount_out = uniswap::detail::get_amount_out( amount_in, reserve_a, reserve_b, fee, protocol_fee );
+            const uint64_t pool_in = amount_in - uniswap::detail::protocol_fee_amount( amount_in, protocol_fee );
+            uint64_t liquidity = 0;
+            if ( !amount_out || !uniswap::detail::get_liquidity( amount - amount_in, amount_out, reserve_a + pool_in, reserve_b - amount_out, supply, liquidity ) ) continue;
+            best = std::max( best, liquidity );
+        }
+        if ( !best ) continue;
+
+        // Calculation
+        const uniswap::zap zap = uniswap::get_zap( amount, reserve_a, reserve_b, supply, fee, protocol_fee );
+        REQUIRE( zap.liquidity == best );
+        REQUIRE( zap.amount_out == uniswap::detail::get_amount_out( zap.amount_in, reserve_a, reserve_b, fee, protocol_fee ) );
+    }
+}
+
+TEST_CASE( "try_get_amount_out #1 (pass)" ) {
+    // Inputs
+    const uint64_t amount_in = 10000;
+    const uint64_t reserve_in = 45851931234;
+    const uint64_t reserve_out = 125682033533;
+
+    // Asserts
+    const uniswap::result result = uniswap::try_get_amount_out( amount_in, reserve_in, reserve_out );
+    REQUIRE( result.ok() );
+    REQUIRE( result.amount == 27328 );
+    REQUIRE( uniswap::try_get_amount_out( 0, reserve_in, reserve_out ).code == uniswap::status::insufficient_input_amount );
+    REQUIRE( uniswap::try_get_amount_out( amount_in, 0, reserve_out ).code == uniswap::status::insufficient_liquidity );
+    REQUIRE( uniswap::try_get_amount_out( amount_in, reserve_in, 0 ).code == uniswap::status::insufficient_liquidity );
+    REQUIRE( uniswap::try_get_amount_out( amount_in, reserve_in, 0 ).amount == 0 );
+    REQUIRE( uniswap::try_get_amount_out( 10, 100, 100, 10001 ).code == uniswap::status::invalid_fee );
+    REQUIRE( uniswap::try_get_amount_out( 10, 100, 100, 10000 ).code == uniswap::status::invalid_fee );
+}
+
+TEST_CASE( "try_get_amount_in #1 (pass)" ) {
+    // Inputs
+    const uint64_t amount_out = 27328;
+    const uint64_t reserve_in = 45851931234;
+    const uint64_t reserve_out = 125682033533;
+
+    // Asserts
+    const uniswap::result result = uniswap::try_get_amount_in( amount_out, reserve_in, reserve_out );
+    REQUIRE( result.ok() );
+    REQUIRE( result.amount == 10000 );
+    REQUIRE( uniswap::try_get_amount_in( 0, reserve_in, reserve_out ).code == uniswap::status::insufficient_output_amount );
+    REQUIRE( uniswap::try_get_amount_in( amount_out, 0, reserve_out ).code == uniswap::status::insufficient_liquidity );
+    REQUIRE( uniswap::try_get_amount_in( amount_out, reserve_in, 0 ).code == uniswap::status::insufficient_liquidity );
+    REQUIRE( uniswap::try_get_amount_in( reserve_out, reserve_in, reserve_out ).code == uniswap::status::insufficient_liquidity );
+    REQUIRE( uniswap::try_get_amount_in( amount_out, reserve_in, reserve_out, 30, 10000 ).code == uniswap::status::invalid_protocol_fee );
+    REQUIRE( uniswap::try_get_amount_in( 1, 1, 2, 10000 ).code == uniswap::status::invalid_fee );
+    REQUIRE( uniswap::try_get_amount_in( amount_out, reserve_in, reserve_out, 10001 ).code == uniswap::status::invalid_fee );
+    REQUIRE( uniswap::try_get_amount_in( ~uint64_t(0) - 1, ~uint64_t(0), ~uint64_t(0) ).code == uniswap::status::overflow );
+}
+
+TEST_CASE( "try_quote #1 (pass)" ) {
+    // Asserts
+    const uniswap::result result = uniswap::try_quote( 10000, 45851931234, 125682033533 );
+    REQUIRE( result.ok() );
+    REQUIRE( result.amount == 27410 );
+    REQUIRE( uniswap::try_quote( 0, 45851931234, 125682033533 ).code == uniswap::status::insufficient_amount );
+    REQUIRE( uniswap::try_quote( 10000, 0, 125682033533 ).code == uniswap::status::insufficient_liquidity );
+    REQUIRE( uniswap::try_quote( ~uint64_t(0), 1, 2 ).code == uniswap::status::overflow );
+}
+
+TEST_CASE( "try_ variants #1 (pass)" ) {
+    xorshift next;
+
+    int mismatches = 0;
+    for ( int i = 0; i < 10000; i++ ) {
+        // Inputs: one in eight reserves empty
+        const uint64_t amount = next() >> (next() % 64);
+        const uint64_t reserve_in = next() % 8 ? next() >> (next() % 64) : 0;
+        const uint64_t reserve_out = next() % 8 ? next() >> (next() % 64) : 0;
+        const uint16_t fee = next() % 100;
+        const uint16_t protocol_fee = next() % 50;
+
+        // valid inputs match the checked functions
+        const uniswap::result out = uniswap::try_get_amount_out( amount, reserve_in, reserve_out, fee, protocol_fee );
+        if ( out.ok() != (amount > 0 && reserve_in > 0 && reserve_out > 0) ) mismatches++;
+        if ( out.ok() && out.amount != uniswap::get_amount_out( amount, reserve_in, reserve_out, fee, protocol_fee ) ) mismatches++;
+
+        const uniswap::result in = uniswap::try_get_amount_in( amount, reserve_in, reserve_out, fee, protocol_fee );
+        if ( in.amount != (in.ok() ? uniswap::get_amount_in( amount, reserve_in, reserve_out, fee, protocol_fee ) : 0) ) mismatches++;
+
+        const uniswap::result quote = uniswap::try_quote( amount, reserve_in, reserve_out );
+        if ( quote.amount != (quote.ok() ? uniswap::quote( amount, reserve_in, reserve_out ) : 0) ) mismatches++;
+    }
+    REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE( "error policies #1 (pass)" ) {
+    // Inputs
+    const uint64_t amount_in = 10000;
+    const uint64_t reserve_in = 45851931234;
+    const uint64_t reserve_out = 125682033533;
+
+    // every policy agrees on valid inputs
+    REQUIRE( uniswap::get_amount_out<uniswap::check_policy>( amount_in, reserve_in, reserve_out ) == 27328 );
+    REQUIRE( uniswap::get_amount_out<uniswap::unchecked_policy>( amount_in, reserve_in, reserve_out ) == 27328 );
+    REQUIRE( uniswap::get_amount_out<uniswap::status_policy>( amount_in, reserve_in, reserve_out ).amount == 27328 );
+    REQUIRE( uniswap::get_amount_out<30, 0, uniswap::unchecked_policy>( amount_in, reserve_in, reserve_out ) == 27328 );
+    REQUIRE( uniswap::get_amount_in<uniswap::unchecked_policy>( 27328, reserve_in, reserve_out ) == 10000 );
+    REQUIRE( uniswap::quote<uniswap::unchecked_policy>( amount_in, reserve_in, reserve_out ) == 27410 );
+
+    // status codes
+    REQUIRE( uniswap::get_amount_out<30, 0, uniswap::status_policy>( amount_in, reserve_in, 0 ).code == uniswap::status::insufficient_liquidity );
+    REQUIRE( uniswap::quote<uniswap::status_policy>( 0, reserve_in, reserve_out ).code == uniswap::status::insufficient_amount );
+
+    // paths and prepared pools
+    const uniswap::hop path[] = { { 100000000, 400000000, 30, 0 }, { 400000000, 100000000, 30, 0 } };
+    const uniswap::hop empty[] = { { 100000000, 400000000, 30, 0 }, { 0, 100000000, 30, 0 } };
+    const uniswap::hop reversed[] = { path[1], path[0] };
+    const uniswap::hop wrapped[] = { path[0], { 400000000, 100000000, 10001, 0 } };
+    uint64_t amounts[3];
+    REQUIRE( uniswap::get_amounts_out<uniswap::unchecked_policy>( amount_in, path, 2, amounts ) == 9938 );
+    REQUIRE( uniswap::get_amounts_out<uniswap::status_policy>( amount_in, path, amounts ).amount == 9938 );
+    REQUIRE( uniswap::get_amounts_out<uniswap::status_policy>( amount_in, path, 0, amounts ).code == uniswap::status::invalid_path );
+    REQUIRE( uniswap::get_amounts_out<uniswap::status_policy>( 0, path, amounts ).code == uniswap::status::insufficient_input_amount );
+    REQUIRE( uniswap::get_amounts_out<uniswap::status_policy>( amount_in, empty, 2, amounts ).code == uniswap::status::insufficient_liquidity );
+    REQUIRE( uniswap::get_amounts_out<uniswap::status_policy>( 1, reversed, amounts ).code == uniswap::status::insufficient_input_amount );
+    REQUIRE( uniswap::get_amounts_out<uniswap::status_policy>( amount_in, wrapped, amounts ).code == uniswap::status::invalid_fee );
+    REQUIRE( uniswap::get_amounts_in<uniswap::unchecked_policy>( 9938, path, 2, amounts ) == 10000 );
+    REQUIRE( uniswap::get_amounts_in<uniswap::status_policy>( 9938, path, amounts ).amount == 10000 );
+    REQUIRE( uniswap::get_amounts_in<uniswap::status_policy>( 9938, path, 0, amounts ).code == uniswap::status::invalid_path );
+    REQUIRE( uniswap::get_amounts_in<uniswap::status_policy>( 0, path, amounts ).code == uniswap::status::insufficient_output_amount );
+    REQUIRE( uniswap::get_amounts_in<uniswap::status_policy>( 9938, empty, 2, amounts ).code == uniswap::status::insufficient_liquidity );
+    REQUIRE( uniswap::get_amounts_in<uniswap::status_policy>( 9938, wrapped, amounts ).code == uniswap::status::invalid_fee );
+    REQUIRE( uniswap::get_amounts_in<uniswap::status_policy>( 400000000, path, amounts ).code == uniswap::status::insufficient_liquidity );
+
+    const uniswap::route route = uniswap::compile_route( path, 2 );
+    REQUIRE( route.get_amount_out<uniswap::unchecked_policy>( amount_in, true ) == 9938 );
+    REQUIRE( route.get_amount_out<uniswap::status_policy>( amount_in, true ).amount == 9938 );
+    REQUIRE( route.get_amount_out<uniswap::status_policy>( 0 ).code == uniswap::status::insufficient_input_amount );
+
+    const uniswap::prepared_pool pool( reserve_in, reserve_out, 30 );
+    REQUIRE( pool.get_amount_out<uniswap::unchecked_policy>( amount_in ) == 27328 );
+    REQUIRE( pool.get_amount_out<uniswap::status_policy>( amount_in ).amount == 27328 );
+    REQUIRE( pool.get_amount_out<uniswap::status_policy>( 0 ).code == uniswap::status::insufficient_input_amount );
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+    // exceptions carry the status and the `eosio::check` message
+    REQUIRE( uniswap::get_amount_out<uniswap::throw_policy>( amount_in, reserve_in, reserve_out ) == 27328 );
+    REQUIRE_THROWS_WITH( uniswap::get_amount_out<uniswap::throw_policy>( amount_in, 0, reserve_out ), "SX.Uniswap: INSUFFICIENT_LIQUIDITY" );
+    REQUIRE_THROWS_WITH( uniswap::get_amount_in<uniswap::throw_policy>( reserve_out, reserve_in, reserve_out ), "SX.Uniswap: INSUFFICIENT_LIQUIDITY" );
+    REQUIRE_THROWS_WITH( uniswap::quote<uniswap::throw_policy>( ~uint64_t(0), 1, 2 ), "SX.Uniswap: OVERFLOW" );
+    REQUIRE_THROWS_WITH( uniswap::get_amounts_out<uniswap::throw_policy>( amount_in, path, 0, amounts ), "SX.Uniswap: INVALID_PATH" );
+    try {
+        uniswap::get_amount_in<uniswap::throw_policy>( 0, reserve_in, reserve_out );
+    } catch ( const uniswap::exception& e ) {
+        REQUIRE( e.code == uniswap::status::insufficient_output_amount );
+    }
+#endif
+
+#if UNISWAP_HAS_CONSTEXPR
+    static_assert( uniswap::get_amount_out<uniswap::unchecked_policy>( 10000, 45851931234, 125682033533 ) == 27328, "get_amount_out<unchecked_policy>" );
+    static_assert( uniswap::get_amount_out<uniswap::status_policy>( 10000, 45851931234, 0 ).code == uniswap::status::insufficient_liquidity, "get_amount_out<status_policy>" );
+#endif
+}
+
+TEST_CASE( "get_amount_out 64-bit fast path #1 (pass)" ) {
+    xorshift next;
+
+    int mismatches = 0;
+    for ( int i = 0; i < 100000; i++ ) {
+        // Inputs: magnitudes straddling the 64-bit bound
+        const uint64_t amount_in = next() >> (next() % 64);
+        const uint64_t reserve_in = next() >> (next() % 24);
+        const uint64_t reserve_out = next() >> (next() % 64);
+        const uint16_t fee_multiplier = 10000 - next() % 100;
+
+        // 128-bit reference
+        const uniswap::uint128 amount_in_with_fee = static_cast<uniswap::uint128>(amount_in) * fee_multiplier;
+        const uniswap::uint128 denominator = static_cast<uniswap::uint128>(reserve_in) * 10000 + amount_in_with_fee;
+        if ( denominator == 0 ) continue;
+        const uint64_t expected = uniswap::detail::mul_div( amount_in_with_fee, reserve_out, denominator );
+        if ( uniswap::detail::get_amount_out_with_fee( amount_in, reserve_in, reserve_out, fee_multiplier ) != expected ) mismatches++;
+
+        const uint16_t protocol_fee = next() % 100;
+        if ( uniswap::detail::protocol_fee_amount( amount_in, protocol_fee ) != std::max<uint64_t>( uniswap::detail::lo( static_cast<uniswap::uint128>(amount_in) * protocol_fee / 10000 ), protocol_fee ? 1 : 0 ) ) mismatches++;
+    }
+    REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE( "get_amount_out benchmark", "[.benchmark]" ) {
+    // Defibox RAMS vector, 64-bit fast path
+    uint64_t amount_in = 1047;
+    BENCHMARK( "get_amount_out 64-bit" ) {
+        return uniswap::get_amount_out( amount_in++, 65394, 93823580, 20, 10 );
+    };
+
+    // wide reserves, 128-bit path
+    BENCHMARK( "get_amount_out 128-bit" ) {
+        return uniswap::get_amount_out( amount_in++, 45851931234000, 125682033533000, 20, 10 );
+    };
+}
+
+TEST_CASE( "math<T> #1 (pass)" ) {
+    // 18 decimals
+    const uniswap::uint128 scale = 100000000000000;
+    const uniswap::uint128 amount_out = uniswap::math<uniswap::uint128>::get_amount_out( 10000 * scale, 45851931234 * scale, 125682033533 * scale );
+    REQUIRE( amount_out == 2732817502205767680ULL );
+    REQUIRE( uniswap::math<uniswap::uint128>::get_amount_out( 10000, 45851931234, 125682033533 ) == 27328 );
+    REQUIRE( uniswap::math<uniswap::uint128>::get_amount_in( 27328, 45851931234, 125682033533 ) == 10000 );
+    REQUIRE( uniswap::math<uniswap::uint128>::quote( 10000, 45851931234, 125682033533 ) == 27410 );
+
+    // narrower and default widths agree
+    REQUIRE( uniswap::math<uint32_t>::get_amount_out( 1047, 65394, 93823580, 20, 10 ) == 1474206 );
+    REQUIRE( uniswap::math<uint32_t>::get_amount_in( 27328, 458519312, 1256820335 ) == uniswap::get_amount_in( 27328, 458519312, 1256820335 ) );
+    REQUIRE( uniswap::math<uint64_t>::get_amount_out( 10000, 45851931234, 125682033533 ) == 27328 );
+}
+
+TEST_CASE( "math<T> #2 (pass)" ) {
+    xorshift next;
+    auto next_uint112 = [&]() {
+        const uniswap::uint128 x = uniswap::detail::make_uint128( next() >> 16, next() );
+        return x >> (next() % 112);
+    };
+
+    int mismatches = 0;
+    for ( int i = 0; i < 10000; i++ ) {
+        // Inputs: reserves beyond 64 bits
+        const uniswap::uint128 amount_in = next_uint112() | 1;
+        const uniswap::uint128 reserve_in = next_uint112() | 1;
+        const uniswap::uint128 reserve_out = next_uint112() | 1;
+        const uint16_t fee = next() % 100;
+
+        // Calculation
+        const uniswap::uint128 amount_out = uniswap::math<uniswap::uint128>::get_amount_out( amount_in, reserve_in, reserve_out, fee );
+        if ( amount_out >= reserve_out ) {
+            mismatches++;
+            continue;
+        }
+
+        // fee-adjusted K holds for `amount_out` and breaks for `amount_out + 1`
+        const uniswap::detail::uint256 k = uniswap::detail::mul_wide( reserve_in * 10000, reserve_out );
+        const uniswap::uint128 balance_in = reserve_in * 10000 + amount_in * (10000 - fee);
+        if ( uniswap::detail::less( uniswap::detail::mul_wide( balance_in, reserve_out - amount_out ), k ) ) mismatches++;
+        if ( !uniswap::detail::less( uniswap::detail::mul_wide( balance_in, reserve_out - amount_out - 1 ), k ) ) mismatches++;
+
+        // `get_amount_in` of the output never exceeds the input
+        if ( amount_out == 0 ) continue;
+        if ( uniswap::math<uniswap::uint128>::get_amount_in( amount_out, reserve_in, reserve_out, fee ) > amount_in ) mismatches++;
+    }
+    REQUIRE( mismatches == 0 );
+}
+
+// restoring binary long division, one bit per step (bignum stand-in)
+static uniswap::uint128 div_wide_reference( const uniswap::detail::uint256& x, const uniswap::uint128 d, uniswap::uint128& r )
+{
+    using namespace uniswap::detail;
+    const uint256 divisor = { 0, d };
+    uniswap::uint128 quotient = 0;
+    uint256 remainder = { 0, 0 };
+    for ( int i = bits(x) - 1; i >= 0; i-- ) {
+        const uniswap::uint128 bit = i >= 128 ? x.high >> (i - 128) : x.low >> i;
+        remainder = shl(remainder, 1);
+        remainder.low |= bit & 1;
+        quotient <<= 1;
+        if ( !less(remainder, divisor) ) {
+            remainder = sub(remainder, divisor);
+            quotient |= 1;
+        }
+    }
+    r = remainder.low;
+    return quotient;
+}
+
+// full-width restoring division, one bit per step
+static uniswap::detail::uint256 div_mod_reference( const uniswap::detail::uint256& u, const uniswap::detail::uint256& v, uniswap::detail::uint256& r )
+{
+    using namespace uniswap::detail;
+    uint256 quotient = { 0, 0 };
+    uint256 remainder = { 0, 0 };
+    for ( int i = bits(u) - 1; i >= 0; i-- ) {
+        remainder = shl(remainder, 1);
+        remainder.low |= static_cast<uniswap::uint128>((limb(u, i / 64) >> (i % 64)) & 1);
+        quotient = shl(quotient, 1);
+        if ( !less(remainder, v) ) {
+            remainder = sub(remainder, v);
+            quotient.low |= static_cast<uniswap::uint128>(1);
+        }
+    }
+    r = remainder;
+    return quotient;
+}
+
+TEST_CASE( "uint256 #1 (pass)" ) {
+    using namespace uniswap::detail;
+    const uniswap::uint128 max = ~uniswap::uint128(0);
+
+    // (2^128 - 1)^2 = 2^256 - 2^129 + 1
+    const uint256 square = mul_wide( max, max );
+    REQUIRE( square.high == max - 1 );
+    REQUIRE( square.low == 1 );
+
+    // quotient at the top of the `x.high < d` domain
+    REQUIRE( div_wide( square, max ) == max );
+    REQUIRE( div_wide( sub( square, uint256{ 0, 1 } ), max ) == max - 1 );
+    REQUIRE( div_wide( uint256{ 1, 0 }, 3 ) == max / 3 );
+
+#if UNISWAP_HAS_CONSTEXPR
+    static_assert( div_wide( mul_wide( 45851931234, 125682033533 ), 125682033533 ) == 45851931234, "div_wide" );
+#endif
+}
+
+TEST_CASE( "uint256 #2 (pass)" ) {
+    using namespace uniswap::detail;
+    xorshift next;
+
+    // limbs biased towards the `div_3by2` correction edge cases
+    auto pick = [&]() -> uint64_t {
+        switch ( next() % 6 ) {
+            case 0: return 0;
+            case 1: return ~uint64_t(0);
+            case 2: return uint64_t(1) << 63;
+            default: return next();
+        }
+    };
+
+    int mismatches = 0;
+    for ( int i = 0; i < 20000; i++ ) {
+        // Inputs: `x.high < d`
+        const uniswap::uint128 d = make_uint128( pick(), pick() ) >> (next() % 128);
+        if ( d == 0 ) continue;
+        const uint256 x = { make_uint128( pick(), pick() ) % d, make_uint128( pick(), pick() ) };
+
+        // Calculation
+        uniswap::uint128 r = 0;
+        const uniswap::uint128 q = div_wide( x, d );
+        if ( q != div_wide_reference( x, d, r ) ) mismatches++;
+        const uint256 back = add( mul_wide( q, d ), uint256{ 0, r } );
+        if ( back.high != x.high || back.low != x.low ) mismatches++;
+    }
+    REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE( "uint256 #3 (pass)" ) {
+    using namespace uniswap::detail;
+
+    // (2^256 - 1) / (2^128 + 1) = 2^128 - 1, remainder 0
+    const uint256 max = from_limbs( ~uint64_t(0), ~uint64_t(0), ~uint64_t(0), ~uint64_t(0) );
+    uint256 r = { 0, 0 };
+    const uint256 q = div_mod( max, from_limbs( 1, 0, 1, 0 ), r );
+    REQUIRE( equal( q, from_limbs( ~uint64_t(0), ~uint64_t(0), 0, 0 ) ) );
+    REQUIRE( equal( r, from_limbs( 0, 0, 0, 0 ) ) );
+
+    // 256/128-bit divisor, quotient beyond 128 bits
+    const uint256 q2 = div_mod( max, from_limbs( 3, 0, 0, 0 ), r );
+    REQUIRE( equal( q2, from_limbs( 0x5555555555555555ULL, 0x5555555555555555ULL, 0x5555555555555555ULL, 0x5555555555555555ULL ) ) );
+    REQUIRE( equal( r, from_limbs( 0, 0, 0, 0 ) ) );
+
+    // truncated product
+    REQUIRE( equal( mul( max, max ), from_limbs( 1, 0, 0, 0 ) ) );
+    REQUIRE( equal( mul( from_limbs( 0, 0, 1, 0 ), from_limbs( 0, 0, 1, 0 ) ), from_limbs( 0, 0, 0, 0 ) ) );
+    REQUIRE( equal( mul( from_limbs( 0, 1, 0, 0 ), from_limbs( 0, 0, 1, 0 ) ), from_limbs( 0, 0, 0, 1 ) ) );
+
+#if UNISWAP_HAS_CONSTEXPR
+    static_assert( equal( div( from_limbs( 0, 0, 0, 6 ), from_limbs( 0, 0, 3, 0 ) ), from_limbs( 0, 2, 0, 0 ) ), "div" );
+#endif
+}
+
+TEST_CASE( "uint256 #4 (pass)" ) {
+    using namespace uniswap::detail;
+    xorshift next;
+
+    // limbs biased towards the Knuth correction edge cases
+    auto pick = [&]() -> uint64_t {
+        switch ( next() % 6 ) {
+            case 0: return 0;
+            case 1: return ~uint64_t(0);
+            case 2: return uint64_t(1) << 63;
+            default: return next();
+        }
+    };
+
+    int mismatches = 0;
+    for ( int i = 0; i < 20000; i++ ) {
+        // Inputs
+        const uint256 v = shr( shr( from_limbs( pick(), pick(), pick(), pick() ), next() % 128 ), next() % 128 );
+        if ( bits(v) == 0 ) continue;
+        const uint256 u = next() % 4 ? from_limbs( pick(), pick(), pick(), pick() ) : mul( v, from_limbs( pick(), pick(), 0, 0 ) );
+
+        // Calculation
+        uint256 r = { 0, 0 };
+        uint256 r_reference = { 0, 0 };
+        const uint256 q = div_mod( u, v, r );
+        if ( !equal( q, div_mod_reference( u, v, r_reference ) ) ) mismatches++;
+        if ( !equal( r, r_reference ) ) mismatches++;
+        if ( !equal( add( mul( q, v ), r ), u ) ) mismatches++;
+    }
+    REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE( "uint256 benchmark", "[.benchmark]" ) {
+    using namespace uniswap::detail;
+    const uniswap::uint128 a = make_uint128( 0x0123456789abcdefULL, 0xfedcba9876543210ULL );
+    const uniswap::uint128 d64 = 0x0f1e2d3c4b5a6978ULL;
+    const uniswap::uint128 d128 = make_uint128( 0x0f1e2d3c4b5a6978ULL, 0x0000000076543210ULL );
+    const uint256 x64 = { a % d64, a };
+    const uint256 x128 = { a % d128, a };
+    uniswap::uint128 r = 0;
+
+    BENCHMARK( "mul_wide 128x128-bit" ) { return mul_wide( a, d128 ); };
+    BENCHMARK( "div_wide 256/64-bit" ) { return div_wide( x64, d64 ); };
+    BENCHMARK( "div_wide 256/64-bit reference" ) { return div_wide_reference( x64, d64, r ); };
+    BENCHMARK( "div_wide 256/128-bit" ) { return div_wide( x128, d128 ); };
+    BENCHMARK( "div_wide 256/128-bit reference" ) { return div_wide_reference( x128, d128, r ); };
+
+    const uint256 u = from_limbs( 0x8796a5b4c3d2e1f0ULL, 0x0f1e2d3c4b5a6978ULL, 0xfedcba9876543210ULL, 0x0123456789abcdefULL );
+    const uint256 v128 = from_limbs( 0x0f1e2d3c4b5a6978ULL, 0x0000000076543210ULL, 0, 0 );
+    const uint256 v192 = from_limbs( 0x0f1e2d3c4b5a6978ULL, 0xfedcba9876543210ULL, 0x000000000089abcdULL, 0 );
+    uint256 rem = { 0, 0 };
+
+    BENCHMARK( "mul 256-bit" ) { return mul( u, v192 ); };
+    BENCHMARK( "div 256/128-bit" ) { return div_mod( u, v128, rem ); };
+    BENCHMARK( "div 256/128-bit reference" ) { return div_mod_reference( u, v128, rem ); };
+    BENCHMARK( "div 256/192-bit" ) { return div_mod( u, v192, rem ); };
+    BENCHMARK( "div 256/192-bit reference" ) { return div_mod_reference( u, v192, rem ); };
+}
+
+TEST_CASE( "verify_k #1 (pass)" ) {
+    // Inputs
+    const uint64_t reserve0 = 45851931234;
+    const uint64_t reserve1 = 125682033533;
+    const uint64_t amount_out = uniswap::get_amount_out( 10000, reserve0, reserve1 );
+
+    // Asserts: `get_amount_out` is the largest output keeping K
+    REQUIRE( uniswap::verify_k( reserve0 + 10000, reserve1 - amount_out, 10000, 0, reserve0, reserve1 ) );
+    REQUIRE( !uniswap::verify_k( reserve0 + 10000, reserve1 - amount_out - 1, 10000, 0, reserve0, reserve1 ) );
+    REQUIRE( uniswap::verify_k( reserve1 - amount_out, reserve0 + 10000, 0, 10000, reserve1, reserve0 ) );
+
+    // balances below the fee, empty pool, full 64-bit operands
+    REQUIRE( !uniswap::verify_k( 0, reserve1, 1, 0, reserve0, reserve1 ) );
+    REQUIRE( uniswap::verify_k( 1, 1, 0, 0, 0, 0 ) );
+    REQUIRE( uniswap::verify_k( ~uint64_t(0), ~uint64_t(0), 0, 0, ~uint64_t(0), ~uint64_t(0) ) );
+    REQUIRE( !uniswap::verify_k( ~uint64_t(0), ~uint64_t(0), 1, 0, ~uint64_t(0), ~uint64_t(0) ) );
+}
+
+TEST_CASE( "verify_k #2 (pass)" ) {
+    using namespace uniswap::detail;
+    xorshift next;
+
+    int mismatches = 0;
+    for ( int i = 0; i < 100000; i++ ) {
+        // Inputs: swaps on either side of the invariant, and arbitrary magnitudes
+        uint64_t reserve0 = next() >> (next() % 64);
+        uint64_t reserve1 = next() >> (next() % 64);
+        uint64_t amount0_in = next() >> (next() % 64);
+        uint64_t amount1_in = next() >> (next() % 64);
+        uint64_t balance0 = next() >> (next() % 64);
+        uint64_t balance1 = next() >> (next() % 64);
+        const uint16_t fee = next() % 100;
+        if ( next() % 2 ) {
+            reserve0 = (next() >> (next() % 40)) | 1;
+            reserve1 = (next() >> (next() % 40)) | 1;
+            amount0_in = (next() >> (next() % 64)) | 1;
+            amount1_in = 0;
+            if ( amount0_in > ~uint64_t(0) - reserve0 ) continue;
+            balance0 = reserve0 + amount0_in;
+            balance1 = reserve1 - uniswap::get_amount_out( amount0_in, reserve0, reserve1, fee ) - next() % 2;
+        }
+
+        // 256-bit reference
+        const uniswap::uint128 scaled0 = static_cast<uniswap::uint128>(balance0) * 10000;
+        const uniswap::uint128 scaled1 = static_cast<uniswap::uint128>(balance1) * 10000;
+        const uniswap::uint128 fee0 = static_cast<uniswap::uint128>(amount0_in) * fee;
+        const uniswap::uint128 fee1 = static_cast<uniswap::uint128>(amount1_in) * fee;
+        const bool expected = scaled0 >= fee0 && scaled1 >= fee1 && !less( mul_wide( scaled0 - fee0, scaled1 - fee1 ), mul_wide( static_cast<uniswap::uint128>(reserve0) * reserve1, 100000000 ) );
+        if ( uniswap::verify_k( balance0, balance1, amount0_in, amount1_in, reserve0, reserve1, fee ) != expected ) mismatches++;
+    }
+    REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE( "verify_k benchmark", "[.benchmark]" ) {
+    const uint64_t reserve0 = 45851931234;
+    const uint64_t reserve1 = 125682033533;
+    uint64_t amount_in = 10000;
+
+    BENCHMARK( "verify_k" ) {
+        const uint64_t amount_out = uniswap::get_amount_out( amount_in, reserve0, reserve1 );
+        const bool valid = uniswap::verify_k( reserve0 + amount_in, reserve1 - amount_out, amount_in, 0, reserve0, reserve1 );
+        amount_in++;
+        return valid;
+    };
+}